@@ -93,7 +93,7 @@ def parse_output(n, d, X, y, lambda_, alg, solution, condition_number,
         m = re.match('OT\s+time:\s*(\S+)', line)
         if m:
             ot_time = float(m.group(1))
-        if alg == 'cgd':
+        if alg.startswith('cgd'):
             if alg_has_scaling:
                 # Reading scaling value m
                 m = re.match('m\s+=\s+((\s*[\d\.-]+)+)', line)
@@ -146,7 +146,7 @@ def parse_output(n, d, X, y, lambda_, alg, solution, condition_number,
             f.write('n d algorithm ot_time time error gate_count')
             f.write('\n{0} {1} {2} {3} {4} {5} {6}'.format(n, d,
                 alg, ot_time, time, error, gate_count))
-            if alg == 'cgd':
+            if alg.startswith('cgd'):
                 try:
                     gate_count_after_iters =\
                         gate_count - cgd_iter_gate_sizes[-1]
@@ -267,6 +267,75 @@ def run_instance_remotely(n, d, X, y, lambda_, alg, solution, condition_number,
 
     return local_out_filepath if is_party_2 else None
 
+def run_subset_test(exec_file, filepath_in, cols, alg, num_iters_cgd,
+        precision, port):
+    """
+    Solves the principal subsystem on [cols] of the system in [filepath_in]
+    once with the [Subsets] argument of test_linear_system, and once from a
+    file that holds just that subsystem, and checks that both results agree.
+    """
+    # copy the entries as they are written, so both runs read the same values
+    with open(filepath_in, 'r') as f:
+        tokens = f.read().split()
+    d = int(tokens[1])
+    A = [tokens[2 + i * d:2 + (i + 1) * d] for i in range(d)]
+    b = tokens[3 + d * d:3 + d * d + d]
+    A_sub = [[A[i][j] for j in cols] for i in cols]
+    b_sub = [b[i] for i in cols]
+    solution = np.linalg.solve(
+        np.array(A_sub, dtype=float), np.array(b_sub, dtype=float))
+    filepath_sub = os.path.splitext(filepath_in)[0] + '_subset.in'
+    with open(filepath_sub, 'w') as f:
+        f.write('{0} {0}\n'.format(len(cols)))
+        for row in A_sub:
+            f.write(' '.join(row) + '\n')
+        f.write('{0}\n{1}\n'.format(len(cols), ' '.join(b_sub)))
+        f.write('{0}\n{1}\n'.format(len(cols), ' '.join(map(repr, solution))))
+
+    results = []
+    runs = [(filepath_in, ','.join(map(str, cols)), 'Result for subset 0:'),
+        (filepath_sub, '', 'Result:')]
+    for (filepath, subsets, prefix) in runs:
+        for party in [1, 2]:
+            filepath_exec = os.path.splitext(filepath)[0] + \
+                '_{0}_subset_p{1}.exec'.format(alg, party)
+            cmd = '{0} {1} {2} {3} {4} {5} {6} {7} > {8} {9}'.format(
+                exec_file, port, party, filepath, alg, num_iters_cgd,
+                precision, subsets, filepath_exec,
+                '&' if party == 1 else '')
+            logger.info('Running in party {0}: {1}'.format(party, cmd))
+            os.system(cmd)
+        with open(filepath_exec, 'r') as f:
+            m = re.search('^' + prefix + '\s*(.+)$', f.read(), re.M)
+        assert m, 'No result in {0}'.format(filepath_exec)
+        results.append(map(float, m.group(1).split()))
+    assert results[0] == results[1], \
+        'Subset {0} of {1} with {2}: {3} != {4}'.format(
+            cols, filepath_in, alg, results[0], results[1])
+    logger.info('Subset {0} with {1} matches the subsystem: {2}'.format(
+        cols, alg, results[0]))
+
+
+def check_mixed_precision(filepath_in):
+    """
+    Checks that the error of ldlt_mixed on the instance in [filepath_in] is
+    at most twice that of ldlt, or below 1e-6, using the .out files of
+    both runs.
+    """
+    errors = {}
+    for alg in ['ldlt', 'ldlt_mixed']:
+        filepath_out = os.path.splitext(filepath_in)[0] + \
+            '_{0}_p2.out'.format(alg)
+        with open(filepath_out, 'r') as f:
+            # second line: n d algorithm ot_time time error gate_count
+            errors[alg] = float(f.read().split('\n')[1].split()[5])
+    assert errors['ldlt_mixed'] <= max(2 * errors['ldlt'], 1e-6), \
+        'ldlt_mixed on {0}: error {1}, but ldlt has {2}'.format(
+            filepath_in, errors['ldlt_mixed'], errors['ldlt'])
+    logger.info('ldlt_mixed error {0}, ldlt error {1}'.format(
+        errors['ldlt_mixed'], errors['ldlt']))
+
+
 def generate_benchmark(dest_folder):
     """
     Writes 100 instances in dest_folder,
@@ -362,7 +431,7 @@ if __name__ == "__main__":
         precision = 60
         instances = generate_benchmark(dest_folder)
         for (n, d, X, y, lambda_, beta, condition_number, objective_value, filepath_in) in instances:
-            for alg in ['cgd', 'cholesky']:
+            for alg in ['cgd', 'cgd_pow2', 'cgd_jacobi', 'cholesky', 'cholesky_recip', 'cholesky_rsqrt', 'ldlt', 'ldlt_recip', 'ldlt_mixed']:
                 for party in [1, 2]:
                     filepath_exec = os.path.splitext(filepath_in)[0] + \
                         '_{0}_p{1}.exec'.format(alg, party)
@@ -386,6 +455,13 @@ if __name__ == "__main__":
                         alg, beta, condition_number,
                         objective_value,
                         out_filename, filepath_exec)
+            check_mixed_precision(filepath_in)
+        # solving a subset must give the same result as solving the
+        # principal submatrix on its own
+        filepath_in = instances[0][8]
+        for alg in ['ldlt', 'cgd']:
+            run_subset_test(exec_file, filepath_in, [0, 2, 3, 7], alg,
+                num_iters_cgd, precision, args.port)
         sys.exit()
 
     num_iters_cgd = 20
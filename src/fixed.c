@@ -1,5 +1,26 @@
 #include "fixed.h"
 
+static int width = FIXED_BIT_SIZE;
+
+bool fixed_set_width(int bits) {
+#if BIT_WIDTH_32 || FIXED_WORDS
+	if(bits != FIXED_BIT_SIZE) return false;
+#else
+	if(bits % 8 || bits < FIXED_MIN_WIDTH || bits > FIXED_BIT_SIZE) return false;
+#endif
+	width = bits;
+	return true;
+}
+
+int fixed_width() {
+	return width;
+}
+
+fixed_t fixed_sign_extend(fixed_t f) {
+	int shift = FIXED_BIT_SIZE - width;
+	return shift ? (fixed_t) ((ufixed_t) f << shift) >> shift : f;
+}
+
 fixed_t double_to_fixed(double d, int p) {
 	return (fixed_t) (d * (1ll << p));
 }
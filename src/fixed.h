@@ -1,5 +1,7 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #if BIT_WIDTH_32
 
@@ -7,7 +9,7 @@
     typedef int32_t fixed_t;
     typedef uint32_t ufixed_t;
     
-#else
+#else // obig, or native words if FIXED_WORDS
 
     #define FIXED_BIT_SIZE 64
     typedef int64_t fixed_t;
@@ -15,5 +17,46 @@
 
 #endif
 
+// The obig backend computes modulo 2^w for a width w chosen at runtime, a
+// multiple of 8 between FIXED_MIN_WIDTH and FIXED_BIT_SIZE. Native backends
+// only support w = FIXED_BIT_SIZE. Values are still stored in fixed_t, phase 1
+// shares are simply reduced modulo 2^w when they enter phase 2.
+#define FIXED_MIN_WIDTH 24
+// Returns false if the width is not supported. ofixed_init, ofixed_acc_init
+// and ofixed_array_new use the width at the time of the call, and values keep
+// it, so it may change between computations (ldlt_mixed decomposes at a
+// narrower width mid-protocol). It is a plain global that worker threads read,
+// so only change it while no worker_pool_run is in progress.
+bool fixed_set_width(int bits);
+int fixed_width();
+// sign-extends the lowest fixed_width() bits of f
+fixed_t fixed_sign_extend(fixed_t f);
+
+// Division engines for ofixed_div and ofixed_div_overflow. The restoring
+// division is exact up to truncation, but its cost grows quadratically with
+// the width of the dividend. OFIXED_DIV_NEWTON multiplies by a reciprocal
+// instead, see ofixed_recip, which is accurate up to a few units in the last
+// place. Native types only support OFIXED_DIV_RESTORING.
+typedef enum {
+	OFIXED_DIV_RESTORING,
+	OFIXED_DIV_NEWTON
+} ofixed_div_engine;
+bool ofixed_set_div_engine(ofixed_div_engine engine); // false if not supported
+
+// Multiplication engines for ofixed_mul and the ofixed_acc functions.
+// OFIXED_MUL_TRUNCATED only computes the partial products that reach the
+// retained bits plus a guard band; its result is at most one unit in the last
+// place below the truncated exact product. Native types only support
+// OFIXED_MUL_FULL.
+typedef enum {
+	OFIXED_MUL_FULL,
+	OFIXED_MUL_TRUNCATED
+} ofixed_mul_engine;
+bool ofixed_set_mul_engine(ofixed_mul_engine engine); // false if not supported
+
+// largest number of bytes held by ofixed arrays at any time, including the
+// wire labels of obig digits, see ofixed_array_new
+size_t ofixed_array_peak_bytes();
+
 fixed_t double_to_fixed(double d, int p);
 double fixed_to_double(fixed_t f, int p);
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "hybrid.h"
+#include "linear.h"
+#include "bcrandom.h"
+#include "obliv_common.h"
+#include "obliv_types.h"
+#include "obliv_bits.h"
+#include "check_error.h"
+
+#define RING_BITS 128
+
+typedef unsigned __int128 u128;
+
+struct hybrid_engine {
+	ProtocolDesc *pd;
+	int party;
+	struct HonestOTExtSender *sender;
+	struct HonestOTExtRecver *recver;
+	BCipherRandomGen *gen;
+};
+
+static u128 ring_load(ring_t x) {
+	return ((u128) x.w[1] << 64) | x.w[0];
+}
+
+static ring_t ring_store(u128 x) {
+	return (ring_t) {{(uint64_t) x, (uint64_t) (x >> 64)}};
+}
+
+hybrid_engine *hybrid_new(ProtocolDesc *pd, int party) {
+	hybrid_engine *e = NULL;
+	check(pd && (party == 1 || party == 2), "hybrid_new: Invalid arguments");
+	e = calloc(1, sizeof(hybrid_engine));
+	check(e, "out of memory");
+	e->pd = pd;
+	e->party = party;
+	orecv(pd, 0, NULL, 0); // flush
+	// the CSP is the sender of the first pair of base OTs
+	if(party == 1) {
+		e->sender = honestOTExtSenderNew(pd, 0);
+		check(e->sender, "Could not set up the OT extension sender");
+		e->recver = honestOTExtRecverNew(pd, 0);
+		check(e->recver, "Could not set up the OT extension receiver");
+	} else {
+		e->recver = honestOTExtRecverNew(pd, 0);
+		check(e->recver, "Could not set up the OT extension receiver");
+		e->sender = honestOTExtSenderNew(pd, 0);
+		check(e->sender, "Could not set up the OT extension sender");
+	}
+	e->gen = newBCipherRandomGen();
+	check(e->gen, "Could not create the random generator");
+	return e;
+
+error:
+	hybrid_free(e);
+	return NULL;
+}
+
+// also releases partially set up engines
+void hybrid_free(hybrid_engine *e) {
+	if(!e) return;
+	if(e->sender) honestOTExtSenderRelease(e->sender);
+	if(e->recver) honestOTExtRecverRelease(e->recver);
+	if(e->gen) releaseBCipherRandomGen(e->gen);
+	free(e);
+}
+
+int hybrid_party(hybrid_engine *e) {
+	return e->party;
+}
+
+void hybrid_random(hybrid_engine *e, ring_t *r, size_t n) {
+	randomizeBuffer(e->gen, (char *) r, n * sizeof(ring_t));
+}
+
+// callback for the OTs of one column, see inner_product_correlator in phase1.c:
+// the t-th OT sends s_t or s_t + 2^t col
+typedef struct {
+	const u128 *col;
+	size_t d;
+} column_args;
+static void column_correlator(char *opt1, const char *opt0, int t, void *vargs) {
+	column_args *args = vargs;
+	u128 *out = (u128 *) opt1;
+	const u128 *s = (const u128 *) opt0;
+	for(size_t i = 0; i < args->d; i++) {
+		out[i] = s[i] + (args->col[i] << t);
+	}
+}
+
+// out -= s_t for every column, the other party receives s_t + p_j col_j
+// summed over the bits t of its share p_j
+static void matvec_ot_sender(hybrid_engine *e, u128 *out, const ring_t *a, size_t d) {
+	u128 *col = malloc(d * sizeof(u128));
+	u128 *s = malloc(RING_BITS * d * sizeof(u128));
+	u128 *t = malloc(RING_BITS * d * sizeof(u128));
+	column_args args = {.col = col, .d = d};
+	for(size_t j = 0; j < d; j++) {
+		for(size_t i = 0; i < d; i++) {
+			col[i] = ring_load(a[idx(i,j)]);
+		}
+		honestCorrelatedOTExtSend1Of2(e->sender,
+			(char *) s,
+			(char *) t,
+			RING_BITS,
+			d * sizeof(u128),
+			column_correlator,
+			&args
+		);
+		for(size_t k = 0; k < RING_BITS * d; k++) {
+			out[k % d] -= s[k];
+		}
+	}
+	free(col);
+	free(s);
+	free(t);
+}
+
+static void matvec_ot_recver(hybrid_engine *e, u128 *out, const ring_t *p, size_t d) {
+	u128 *t = malloc(RING_BITS * d * sizeof(u128));
+	bool sel[RING_BITS];
+	for(size_t j = 0; j < d; j++) {
+		u128 p_j = ring_load(p[j]);
+		for(int b = 0; b < RING_BITS; b++) {
+			sel[b] = (p_j >> b) & 1;
+		}
+		honestCorrelatedOTExtRecv1Of2(e->recver,
+			(char *) t,
+			sel,
+			RING_BITS,
+			d * sizeof(u128)
+		);
+		for(size_t k = 0; k < RING_BITS * d; k++) {
+			out[k % d] += t[k];
+		}
+	}
+	free(t);
+}
+
+void hybrid_matvec(hybrid_engine *e, ring_t *out, const ring_t *a, const ring_t *p, size_t d) {
+	u128 *acc = calloc(d, sizeof(u128));
+	// (a1 + a2) (p1 + p2): the products of our own shares are local
+	for(size_t i = 0; i < d; i++) {
+		for(size_t j = 0; j < d; j++) {
+			acc[i] += ring_load(a[idx(i,j)]) * ring_load(p[j]);
+		}
+	}
+	// the cross terms a1 p2 and a2 p1 take one OT per bit of p2 and p1
+	orecv(e->pd, 0, NULL, 0); // flush
+	if(e->party == 1) {
+		matvec_ot_sender(e, acc, a, d);
+		orecv(e->pd, 0, NULL, 0); // flush again
+		matvec_ot_recver(e, acc, p, d);
+	} else {
+		matvec_ot_recver(e, acc, p, d);
+		orecv(e->pd, 0, NULL, 0); // flush again
+		matvec_ot_sender(e, acc, a, d);
+	}
+	orecv(e->pd, 0, NULL, 0); // flush again
+	for(size_t i = 0; i < d; i++) {
+		out[i] = ring_store(acc[i]);
+	}
+	free(acc);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "obliv.h"
+
+// Arithmetic sharing for the linear parts of phase 2. The CSP and the
+// Evaluator each hold a share of a value, and the value is the sum of both
+// shares mod 2^128. Sums of shares are computed locally, products of shares
+// by correlated OT as in phase 1, and values are converted from and to the
+// garbled circuit by hybrid_share and hybrid_unshare in hybrid.oh.
+
+// an element of Z_(2^128), least significant word first
+typedef struct {
+	uint64_t w[2];
+} ring_t;
+
+// OT extensions in both directions between the CSP and the Evaluator
+typedef struct hybrid_engine hybrid_engine;
+
+// sets up the engine on the phase 2 link pd, for party 1 or 2. Both parties
+// must call it at the same point of the protocol. Returns NULL on error.
+hybrid_engine *hybrid_new(ProtocolDesc *pd, int party);
+void hybrid_free(hybrid_engine *e);
+int hybrid_party(hybrid_engine *e);
+// fills r with n uniformly random ring elements
+void hybrid_random(hybrid_engine *e, ring_t *r, size_t n);
+// out[i] = our share of the sum of a[idx(i,j)] p[j] over j, for shares a of
+// a packed symmetric d x d matrix and p of a vector. This takes 2 * 128 * d
+// OTs of d ring elements each.
+void hybrid_matvec(hybrid_engine *e, ring_t *out, const ring_t *a, const ring_t *p, size_t d);
@@ -3,11 +3,13 @@
 #include<obliv_types_internal.h>
 #include<obliv_common.h>
 #include<obliv_yao.h>
+#include<obliv_bits.h>
 #include<obliv.h>
 #include<assert.h>
 #include<error.h>
 #include<errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "secure_multiplication/node.h"
 #include "fixed.h"
 
@@ -19,12 +21,15 @@ static void flush(ProtocolDesc* pd)
 {
   orecv(pd,0,NULL,0); // hack that causes two parties to flush
 }
+// returns NULL if the base OTs with the CSP could not be set up
 DualconS* dcsConnect(node *self)
 {
   DualconS* dcs = malloc(sizeof(*dcs));
+  if(!dcs) return NULL;
   dhRandomInit();
   dcs->self = self;
-  dcs->r = honestOTExtRecverNew(self->peer[0],0);
+  dcs->r = honestOTExtRecverNew(self->input_peer[0],0);
+  if(!dcs->r) { free(dcs); return NULL; }
   return dcs;
 }
 void dcsClose(DualconS* dcs)
@@ -32,18 +37,21 @@ void dcsClose(DualconS* dcs)
   honestOTExtRecverRelease(dcs->r);
   free(dcs);
 }
-static const int intsize = FIXED_BIT_SIZE;
 void dcsSendIntArray(DualconS* dcs,const ufixed_t* input,size_t n)
 {
-  size_t i,j,nn = n*intsize;
+  size_t intsize = fixed_width(); // higher bits vanish modulo 2^width
+  size_t i,j,k,nn = DUALCON_CHUNK_WORDS*intsize;
   bool* sel = malloc(nn*sizeof(bool));
   char* buf = malloc(nn*YAO_KEY_BYTES);
-  for(i=0;i<n;++i) for(j=0;j<intsize;++j) sel[i*intsize+j]=((input[i]>>j)&1);
-  // receive keys from CSP
-  honestOTExtRecv1Of2(dcs->r,buf,sel,nn,YAO_KEY_BYTES);
-  // send keys to Evaluator
-  osend(dcs->self->peer[1],0,buf,nn*YAO_KEY_BYTES);
-  flush(dcs->self->peer[1]);
+  for(k=0;k<n;k+=DUALCON_CHUNK_WORDS)
+  { size_t len = n-k < DUALCON_CHUNK_WORDS ? n-k : DUALCON_CHUNK_WORDS;
+    for(i=0;i<len;++i) for(j=0;j<intsize;++j) sel[i*intsize+j]=((input[k+i]>>j)&1);
+    // receive keys from CSP
+    honestOTExtRecv1Of2(dcs->r,buf,sel,len*intsize,YAO_KEY_BYTES);
+    // send keys to Evaluator
+    osend(dcs->self->input_peer[1],0,buf,len*intsize*YAO_KEY_BYTES);
+    flush(dcs->self->input_peer[1]);
+  }
   free(buf);
   free(sel);
 }
@@ -55,16 +63,58 @@ struct DualconR
 };
 
 bool meCsp() { return ocCurrentParty()==1; }
+
+typedef struct
+{ DualconR* dcr;
+  int party;
+  char *buf0, *buf1; // keys to send (CSP), or receive into (Evaluator)
+  size_t n;
+} DualconRThreadArgs;
+
+static void* dcrConnectThread(void* vargs)
+{
+  DualconRThreadArgs* args = vargs;
+  int p = args->party;
+  dhRandomInit(); // as in phase 1, every thread needs this
+  args->dcr->s[p-3] = honestOTExtSenderNew(args->dcr->self->input_peer[p-1],0);
+  return NULL;
+}
+// does not need a running protocol, so it can be called before phase 2 starts.
+// Returns NULL if the base OTs with any provider could not be set up.
 DualconR* dcrConnect(node *self)
 {
-  int p;
-  flush(ocCurrentProto());
+  int p,started=0;
+  bool csp = self->party==1;
+  int np = self->num_parties-2;
+  pthread_t* thread = NULL;
+  DualconRThreadArgs* args = NULL;
   DualconR* dcr = malloc(sizeof*dcr);
+  if(!dcr) return NULL;
   dcr->self = self;
-  dcr->s = meCsp()?malloc(sizeof(struct HonestOTExtSender*)*self->num_parties):0;
-  if(meCsp()) for(p=0;p<self->num_parties-2;++p)
-    dcr->s[p] = honestOTExtSenderNew(self->peer[p+2],0);
+  dcr->s = csp?calloc(self->num_parties,sizeof(struct HonestOTExtSender*)):0;
+  if(csp && !dcr->s) goto error;
+  if(csp)
+  { // base OTs with all providers run concurrently
+    thread = malloc(np*sizeof(pthread_t));
+    args = malloc(np*sizeof(DualconRThreadArgs));
+    if(!thread || !args) goto error;
+    for(p=0;p<np;++p)
+    { args[p] = (DualconRThreadArgs){.dcr = dcr, .party = p+3};
+      if(pthread_create(&thread[p],NULL,dcrConnectThread,&args[p])) break;
+    }
+    started = p;
+    for(p=0;p<started;++p) pthread_join(thread[p],NULL);
+    if(started<np) goto error;
+    for(p=0;p<np;++p) if(!dcr->s[p]) goto error;
+    free(thread);
+    free(args);
+  }
   return dcr;
+error:
+  free(thread);
+  free(args);
+  dcrClose(dcr);
+  return NULL;
 }
 
 void dcrClose(DualconR* dcr)
@@ -72,41 +122,148 @@ void dcrClose(DualconR* dcr)
   int p;
   for(p=0;p<dcr->self->num_parties-2;++p)
   {
-    if(dcr->s) honestOTExtSenderRelease(dcr->s[p]);
+    if(dcr->s && dcr->s[p]) honestOTExtSenderRelease(dcr->s[p]);
   }
   free(dcr->s); free(dcr);
 }
 
+// Evaluator: turns received keys into input wires
+static void dcrSetKeys(YaoProtocolDesc* ypd,OblivBit* dest,const char* buf,size_t n)
+{
+  size_t i;
+  for(i=0;i<n;++i)
+  { yaoKeyCopy(dest[i].yao.w,buf+i*YAO_KEY_BYTES);
+    dest[i].unknown=true;
+    dest[i].yao.inverted=false;
+    ypd->icount++;
+  }
+}
+// CSP: generates fresh input wires and the keys to transfer for them
+static void dcrNewKeys(YaoProtocolDesc* ypd,OblivBit* dest,char* buf0,char* buf1,size_t n)
+{
+  yao_key_t w0,w1;
+  size_t i;
+  for(i=0;i<n;++i)
+  { yaoKeyNewPair(ypd,w0,w1); // does ypd->icount++
+    yaoKeyCopy(buf0+YAO_KEY_BYTES*i,w0);
+    yaoKeyCopy(buf1+YAO_KEY_BYTES*i,w1);
+    dest[i].unknown=true; dest[i].yao.inverted=false;
+    yaoKeyCopy(dest[i].yao.w,w0);
+  }
+}
+
 void dcrRecvBitArray(DualconR* dcr,OblivBit* dest,size_t n,int p)
 {
   YaoProtocolDesc* ypd = ocCurrentProto()->extra;
   if(!meCsp()) // I am "evaluator"
   { char* buf = malloc(YAO_KEY_BYTES*n);
-    orecv(dcr->self->peer[p-1],0,buf,n*YAO_KEY_BYTES);
-    int i;
-    for(i=0;i<n;++i)
-    { yaoKeyCopy(dest[i].yao.w,buf+i*YAO_KEY_BYTES);
-      dest[i].unknown=true;
-      dest[i].yao.inverted=false;
-      ypd->icount++;
-    }
+    orecv(dcr->self->input_peer[p-1],0,buf,n*YAO_KEY_BYTES);
+    dcrSetKeys(ypd,dest,buf,n);
     free(buf);
   }
   else // I am CSP
   { char *buf0 = malloc(YAO_KEY_BYTES*n);
     char *buf1 = malloc(YAO_KEY_BYTES*n);
-    yao_key_t w0,w1;
-    int i;
-    for(i=0;i<n;++i)
-    { yaoKeyNewPair(ypd,w0,w1); // does ypd->icount++
-      yaoKeyCopy(buf0+YAO_KEY_BYTES*i,w0);
-      yaoKeyCopy(buf1+YAO_KEY_BYTES*i,w1);
-      dest[i].unknown=true; dest[i].yao.inverted=false;
-      yaoKeyCopy(dest[i].yao.w,w0);
-    }
+    dcrNewKeys(ypd,dest,buf0,buf1,n);
     honestOTExtSend1Of2(dcr->s[p-3],buf0,buf1,n,YAO_KEY_BYTES);
-    flush(dcr->self->peer[p-1]);
+    flush(dcr->self->input_peer[p-1]);
     free(buf0);
     free(buf1);
   }
 }
+
+static void* dcrSendThread(void* vargs)
+{
+  DualconRThreadArgs* args = vargs;
+  int p = args->party;
+  honestOTExtSend1Of2(args->dcr->s[p-3],args->buf0,args->buf1,args->n,YAO_KEY_BYTES);
+  flush(args->dcr->self->input_peer[p-1]);
+  return NULL;
+}
+static void* dcrRecvThread(void* vargs)
+{
+  DualconRThreadArgs* args = vargs;
+  orecv(args->dcr->self->input_peer[args->party-1],0,args->buf0,args->n*YAO_KEY_BYTES);
+  return NULL;
+}
+
+int dcrRecvBitArrays(DualconR* dcr,OblivBit** dest,size_t n)
+{
+  YaoProtocolDesc* ypd = ocCurrentProto()->extra;
+  int p, started, np = dcr->self->num_parties-2;
+  pthread_t* thread = malloc(np*sizeof(pthread_t));
+  DualconRThreadArgs* args = calloc(np,sizeof(DualconRThreadArgs));
+  if(!thread || !args) goto error;
+  for(p=0;p<np;++p)
+  { args[p] = (DualconRThreadArgs){.dcr = dcr, .party = p+3, .n = n};
+    args[p].buf0 = malloc(YAO_KEY_BYTES*n);
+    args[p].buf1 = meCsp()?malloc(YAO_KEY_BYTES*n):NULL;
+    if(!args[p].buf0 || (meCsp() && !args[p].buf1)) goto error;
+  }
+  if(meCsp())
+  { // wires must be created in provider order, before any thread starts
+    for(p=0;p<np;++p) dcrNewKeys(ypd,dest[p],args[p].buf0,args[p].buf1,n);
+    for(p=0;p<np;++p)
+      if(pthread_create(&thread[p],NULL,dcrSendThread,&args[p])) break;
+    started = p;
+    for(p=0;p<started;++p) pthread_join(thread[p],NULL);
+    if(started<np) goto error;
+  }
+  else
+  { for(p=0;p<np;++p)
+      if(pthread_create(&thread[p],NULL,dcrRecvThread,&args[p])) break;
+    started = p;
+    for(p=0;p<started;++p) pthread_join(thread[p],NULL);
+    if(started<np) goto error;
+    for(p=0;p<np;++p) dcrSetKeys(ypd,dest[p],args[p].buf0,n);
+  }
+  for(p=0;p<np;++p)
+  { free(args[p].buf0);
+    free(args[p].buf1);
+  }
+  free(thread);
+  free(args);
+  return 0;
+error:
+  if(args) for(p=0;p<np;++p)
+  { free(args[p].buf0);
+    free(args[p].buf1);
+  }
+  free(thread);
+  free(args);
+  return 1;
+}
+
+// Receivers of dcsSendIntArray: only the lowest fixed_width() bits of every
+// word are transferred, the others become known zeros and cost no gates.
+static void dcrScatterWords(OblivBit* dest,const OblivBit* src,size_t n,size_t wordsize)
+{
+  size_t i,j,width = fixed_width();
+  for(i=0;i<n;++i) for(j=0;j<wordsize;++j)
+  { if(j<width) dest[i*wordsize+j]=src[i*width+j];
+    else __obliv_c__assignBitKnown(&dest[i*wordsize+j],false);
+  }
+}
+void dcrRecvWordArray(DualconR* dcr,OblivBit* dest,size_t n,size_t wordsize,int p)
+{
+  size_t width = fixed_width();
+  OblivBit* bits = malloc(n*width*sizeof(OblivBit));
+  dcrRecvBitArray(dcr,bits,n*width,p);
+  dcrScatterWords(dest,bits,n,wordsize);
+  free(bits);
+}
+int dcrRecvWordArrays(DualconR* dcr,OblivBit** dest,size_t n,size_t wordsize)
+{
+  size_t width = fixed_width();
+  int p, res = 1, np = dcr->self->num_parties-2;
+  OblivBit** bits = calloc(np,sizeof(OblivBit*));
+  if(!bits) return 1;
+  for(p=0;p<np;++p) if(!(bits[p] = malloc(n*width*sizeof(OblivBit)))) goto done;
+  if(dcrRecvBitArrays(dcr,bits,n*width)) goto done;
+  for(p=0;p<np;++p) dcrScatterWords(dest[p],bits[p],n,wordsize);
+  res = 0;
+done:
+  for(p=0;p<np;++p) free(bits[p]);
+  free(bits);
+  return res;
+}
@@ -3,18 +3,44 @@
 #include "secure_multiplication/node.h"
 #include "fixed.h"
 
+// Data providers send their shares in windows of this many words, so that
+// transient buffers on all sides are independent of the size of the system.
+#define DUALCON_CHUNK_WORDS 4096
+
 typedef struct DualconR DualconR;
 typedef struct DualconS DualconS;
 
+// returns NULL if the connection could not be set up
 DualconS* dcsConnect(node *self);
+// sends input in windows of DUALCON_CHUNK_WORDS words
 void dcsSendIntArray(DualconS* con,const ufixed_t* input,size_t n);
 void dcsClose(DualconS* con);
 
+// returns NULL if the connection could not be set up
 DualconR* dcrConnect(node *self);
 void dcrRecvBitArray(DualconR* con,OblivBit* dest,size_t n,int party);
+// Receives n bits from every data provider at once, into dest[k-3] for party k.
+// OT extensions and key relays run concurrently, one thread per provider,
+// but wire labels are assigned in provider order, as with dcrRecvBitArray.
+// Returns nonzero if the threads could not be started.
+int dcrRecvBitArrays(DualconR* con,OblivBit** dest,size_t n);
+// Counterparts of dcsSendIntArray: receive the lowest fixed_width() bits of
+// n words with wordsize bits each, the remaining bits are set to known zeros.
+void dcrRecvWordArray(DualconR* con,OblivBit* dest,size_t n,size_t wordsize,int party);
+int dcrRecvWordArrays(DualconR* con,OblivBit** dest,size_t n,size_t wordsize);
 #ifdef __oblivious_c
 static inline void
 dcrRecvIntArray(DualconR* con,obliv ufixed_t* input,size_t n,int party)
-  { dcrRecvBitArray(con,(OblivBit*)input,n*ocBitSize(*input),party); }
+  { dcrRecvWordArray(con,(OblivBit*)input,n,ocBitSize(*input),party); }
+static inline int
+dcrRecvIntArrays(DualconR* con,obliv ufixed_t** input,size_t n,int providers)
+{ OblivBit** dest = malloc(providers*sizeof(OblivBit*));
+  int p, res;
+  if(!dest) return 1;
+  for(p=0;p<providers;++p) dest[p]=(OblivBit*)input[p];
+  res = dcrRecvWordArrays(con,dest,n,ocBitSize(*input[0]));
+  free(dest);
+  return res;
+}
 #endif
 void dcrClose(DualconR* con);
@@ -100,3 +100,42 @@ error:
 	return 1;
 
 }
+
+int subsets_parse(const char *list, subset_t **subsets, size_t *num_subsets) {
+	size_t num = 1;
+	for(const char *c = list; *c; c++) {
+		if(*c == ':') num++;
+	}
+	*subsets = calloc(num, sizeof(subset_t));
+	check(*subsets, "out of memory");
+	*num_subsets = num;
+	char *end = (char *) list;
+	for(size_t k = 0; k < num; k++) {
+		subset_t *s = &(*subsets)[k];
+		s->len = 1;
+		for(char *c = end; *c && *c != ':'; c++) {
+			if(*c == ',') s->len++;
+		}
+		s->cols = malloc(s->len * sizeof(size_t));
+		check(s->cols, "out of memory");
+		for(size_t i = 0; i < s->len; i++) {
+			char *start = end;
+			s->cols[i] = strtoul(start, &end, 10);
+			check(end != start && *end == (i + 1 < s->len ? ',' : (k + 1 < num ? ':' : '\0')),
+				"Subsets must be colon-separated lists of comma-separated column indices");
+			check(!i || s->cols[i] > s->cols[i-1], "The columns of every subset must be increasing");
+			end++;
+		}
+	}
+	return 0;
+
+error:
+	return -1;
+}
+
+void subsets_free(subset_t *subsets, size_t num_subsets) {
+	for(size_t k = 0; subsets && k < num_subsets; k++) {
+		free(subsets[k].cols);
+	}
+	free(subsets);
+}
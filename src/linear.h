@@ -1,5 +1,6 @@
 #pragma once
 #include <stdio.h>
+#include <stdbool.h>
 #include "fixed.h"
 #include "secure_multiplication/node.h"
 
@@ -13,6 +14,19 @@ typedef struct {
 	fixed_t *value;
 } vector_t;
 
+// what iterative solvers reveal to the Evaluator and print after every iteration
+typedef enum {
+	TRACE_FULL, // the current solution and all scalars, the default
+	TRACE_SUMMARY, // the scalars, gate count and time only
+	TRACE_OFF // nothing, no intermediate values are revealed
+} trace_level;
+
+// columns of X, whose normal equations are a principal submatrix of the system
+typedef struct {
+	size_t len;
+	size_t *cols; // increasing
+} subset_t;
+
 typedef struct {
 	matrix_t a;
 	vector_t b;
@@ -20,7 +34,23 @@ typedef struct {
 	int precision;
 	long long gates;
 	int num_iterations; // for cgd
+	double tolerance; // if positive, cgd stops once max |g_i| is below it
+	int check_every; // iterations between two tests against tolerance
+	double lambda; // regularisation already added to the diagonal of a
+	const double *lambda_path; // further lambdas for cgd, each solved starting from the previous solution
+	size_t lambda_path_len;
+	int path_iterations; // cgd iterations for every further lambda
+	int refinement_steps; // for ldlt_mixed, 0 selects its default
 	node *self; // for reading input from data providers
+	bool preaggregated; // a and b hold one of two aggregate shares of the packed system
+	struct DualconR *input_conn; // connection to data providers, if already set up
+	int a_bits; // public bound |a_ij| < 2^a_bits in units of 2^-precision, 0 if unknown
+	const char *out_of_core_dir; // if not NULL, the solvers keep a in a file in this directory
+	trace_level trace; // for iterative solvers
+	int threads; // threads per party for the row kernels of the solvers, 0 or 1 for one
+	bool hybrid; // cgd computes p'*A on arithmetic shares, see hybrid.h
+	const subset_t *subset; // set by solve_subsets, the solvers read this part of the system
+	struct subset_system *subset_system; // the full garbled system for solve_subsets
 } linear_system_t;
 
 // helper function that maps indices into a symmetric matrix
@@ -32,8 +62,38 @@ fixed_t inner_product(vector_t *, vector_t *);
 
 // functions to solve LSs
 void cholesky(void *);
+void cholesky_rsqrt(void *); // cholesky with one inverse square root per column
+void cholesky_recip(void *); // cholesky with one reciprocal per pivot
 void ldlt(void *);
+void ldlt_recip(void *); // ldlt with one reciprocal per pivot
+void ldlt_mixed(void *); // ldlt at half the width with iterative refinement
 void cgd(void *);
+void cgd_pow2(void *); // cgd with power-of-two gradient scaling
+void cgd_jacobi(void *); // cgd with a diagonal preconditioner
+
+// solvers by name, as selected on the command line
+typedef struct {
+	const char *name;
+	void (*solve)(void *); // protocol function taking a linear_system_t
+	bool iterative; // uses linear_system_t.num_iterations
+} linear_solver_t;
+extern const linear_solver_t linear_solvers[]; // terminated by a NULL name
+// returns NULL if there is no solver with the given name
+const linear_solver_t *linear_solver_find(const char *name);
+
+// Protocol function that reads the system once and solves it for every
+// subset with the given solver, in the same protocol run. Party 2 prints the
+// result of every subset, ls->beta holds the last one.
+typedef struct {
+	linear_system_t *ls;
+	void (*solve)(void *);
+	const subset_t *subsets;
+	size_t num_subsets;
+} subset_args;
+void solve_subsets(void *);
+// parses subsets of columns, e.g. 0,1,2:1,3 for {0, 1, 2} and {1, 3}
+int subsets_parse(const char *list, subset_t **subsets, size_t *num_subsets);
+void subsets_free(subset_t *subsets, size_t num_subsets);
 
 // IO helpers
 int read_matrix(FILE *, matrix_t *, int, bool, double);
@@ -1,8 +1,13 @@
 #include <string.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
 #include <obliv.h>
 #include <obliv_common.h>
 
@@ -14,7 +19,7 @@
 #include "secure_multiplication/phase1.h"
 #include "input.h"
 #include "util.h"
-#include "secure_multiplication/node.h"
+#include "secure_multiplication/shm.h"
 
 
 static int barrier(node *self) {
@@ -41,48 +46,133 @@ error:
 	return -1;
 }
 
+// Party 1 sends its width to all other parties, which answer with theirs.
+// Shares of phase 1 are computed modulo 2^width, so all parties must agree.
+static int check_width(node *self) {
+	int width = fixed_width(), other;
+	if(self->party == 1) {
+		for(int i = 1; i < self->num_parties; i++) {
+			check(osend(self->peer[i], 0, &width, sizeof(width)) == sizeof(width),
+				"osend: %s", strerror(errno));
+			orecv(self->peer[i],0,NULL,0); // flush
+		}
+		for(int i = 1; i < self->num_parties; i++) {
+			check(orecv(self->peer[i], 0, &other, sizeof(other)) == sizeof(other),
+				"orecv: %s", strerror(errno));
+			check(other == width, "Party 1 uses width %d, but party %d uses width %d",
+				width, i+1, other);
+		}
+	} else {
+		check(orecv(self->peer[0], 0, &other, sizeof(other)) == sizeof(other),
+			"orecv: %s", strerror(errno));
+		check(osend(self->peer[0], 0, &width, sizeof(width)) == sizeof(width),
+			"osend: %s", strerror(errno));
+		orecv(self->peer[0],0,NULL,0); // flush
+		check(other == width, "Party %d uses width %d, but party 1 uses width %d",
+			self->party, width, other);
+	}
+	return 0;
+
+error:
+	return -1;
+}
+
+// the integer part of values, including the sign, must have at least this many bits
+#define MIN_INTEGER_BITS 4
 
-int main(int argc, char **argv) {
+// command line arguments shared by all parties
+typedef struct {
+	char *input_file;
+	int precision;
+	int party;
+	char *algorithm;
+	int num_iterations;
+	double lambda;
+	bool use_ot;
+	bool local;
+	bool preaggregate;
+	bool range_analysis;
+	char *out_of_core_dir;
+	trace_level trace;
+	double tolerance;
+	int check_every;
+	double *lambda_path;
+	size_t lambda_path_len;
+	int path_iterations;
+	int refinement_steps;
+	int threads;
+	bool hybrid;
+	subset_t *subsets;
+	size_t num_subsets;
+} options;
+
+// bound on the entries of the system in bits, for inputs in [-1,1]: phase 1
+// scales the Gram matrix so that |a_ij| <= 1/d, lambda is added to the diagonal
+static int gram_bound_bits(config *c, int precision, double lambda) {
+	return precision + (int) ceil(log2(1.0 / c->d + lambda)) + 1;
+}
+
+// parses a comma-separated list of lambdas
+static int parse_lambda_path(options *opt, char *list) {
+	size_t len = 1;
+	for(char *c = list; *c; c++) {
+		if(*c == ',') len++;
+	}
+	opt->lambda_path = malloc(len * sizeof(double));
+	check(opt->lambda_path, "out of memory");
+	opt->lambda_path_len = len;
+	char *end = list;
+	for(size_t i = 0; i < len; i++) {
+		opt->lambda_path[i] = strtod(end, &end);
+		check(*end == (i + 1 < len ? ',' : '\0'), "--lambda_path must be a comma-separated list of numbers");
+		end++;
+	}
+	return 0;
+
+error:
+	return -1;
+}
+
+// connections for phase 2 input are set up in the background during phase 1
+typedef struct {
+	node *self;
+	DualconR *dcr; // CSP and Evaluator
+	DualconS *dcs; // data providers
+	int status; // nonzero if the connection could not be set up
+} input_setup_args;
+
+static void *input_setup_thread(void *vargs) {
+	input_setup_args *args = vargs;
+	if(args->self->party < 3) {
+		args->dcr = dcrConnect(args->self);
+		args->status = !args->dcr;
+	} else {
+		args->dcs = dcsConnect(args->self);
+		args->status = !args->dcs;
+	}
+	return NULL;
+}
+
+// runs both phases of the protocol as the party given in opt. If mesh is not
+// NULL, we talk to the other parties through shared memory instead of TCP.
+static int run_node(options *opt, shm_mesh *mesh) {
 	ufixed_t *share_A = NULL, *share_b = NULL;
 	config *c = NULL;
 	node *self = NULL;
 	int status;
-
-	// parse arguments
-	check(argc > 6, "Usage: %s [Input_file] [Precision] [Party] [Algorithm] [Num. iterations CGD] [Lambda] [Options]\nOptions: --use_ot: Enables the OT-based phase 1 protocol", argv[0]);
-	char *end;
-	int precision = (int) strtol(argv[2], &end, 10);
-	check(!errno, "strtol: %s", strerror(errno));
-	check(!*end, "Precision must be a number");
-	int party = (int) strtol(argv[3], &end, 10);
-	check(!errno, "strtol: %s", strerror(errno));
-	check(!*end, "Party must be a number");
-	char *algorithm = argv[4];
-	check(!strcmp(algorithm, "cholesky") || !strcmp(algorithm, "ldlt")  || !strcmp(algorithm, "cgd"),
-	      "Algorithm must be cholesky, ldlt, or cgd.");
-	check(strcmp(algorithm, "cgd") || argc >= 7, "Number of iterations for CGD must be provided");
-	double lambda = (double) strtod(argv[6], &end);
-	check(!errno, "strtod: %s", strerror(errno));
-	check(!*end, "lambda must be a number");
-	
-	// parse options
-	bool use_ot = false;
-	for(int i = 7; i < argc; i++) {
-		if(!strcmp(argv[i], "--use_ot")) {
-			use_ot = true;
-		}
-	}
+	pthread_t input_setup;
+	input_setup_args setup = {0};
+	bool setup_running = false;
+	int party = opt->party;
+	int precision = opt->precision;
+	char *algorithm = opt->algorithm;
 
 	// read ls, we only need number of iterations
-	linear_system_t ls;
-	if(!strcmp(algorithm, "cgd")){
-	       ls.num_iterations = atoi(argv[5]);
-	} else {
-	       ls.num_iterations = 0;
-	}
+	linear_system_t ls = {0};
+	ls.num_iterations = opt->num_iterations;
 
 	// read config
-	status = config_new(&c, argv[1]);
+	status = config_new(&c, opt->input_file);
 	check(!status, "Could not read config");
 	c->party = party;
 	double time = wallClock();
@@ -90,19 +180,38 @@ int main(int argc, char **argv) {
 		printf("{\"n\":\"%zd\", \"d\":\"%zd\" \"p\":\"%d\"}\n", c->n, c->d, c->num_parties - 1);
 	}
 
-	status = node_new(&self, c);
+	if(mesh) {
+		status = node_new_shm(&self, c, mesh);
+	} else {
+		status = node_new(&self, c);
+	}
 	check(!status, "Could not create node");
+	check(!check_width(self), "The parties must use the same --width");
+
+	// base OTs and OT extension setup for phase 2 overlap with phase 1
+	if(!opt->preaggregate) {
+		setup.self = self;
+		status = pthread_create(&input_setup, NULL, input_setup_thread, &setup);
+		check(!status, "pthread_create: %s", strerror(status));
+		setup_running = true;
+	}
 
 	if(party == 1) {
 		//printf("Party %d running as TI\n", party);
-		status = run_trusted_initializer(self, c, precision, use_ot);
+		status = run_trusted_initializer(self, c, precision, opt->use_ot);
 		check(!status, "Error while running trusted initializer");
 	} else if(party > 2){
 		//printf("Party %d running as DP\n", party);
-		status = run_party(self, c, precision, NULL, &share_A, &share_b, use_ot);
+		status = run_party(self, c, precision, NULL, &share_A, &share_b, opt->use_ot);
 		check(!status, "Error while running party %d", party);
 	}
 
+	if(setup_running) {
+		pthread_join(input_setup, NULL);
+		setup_running = false;
+		check(!setup.status, "Could not set up the connections for phase 2 input");
+	}
+
 	// wait until everybody has finished
 	check(!barrier(self), "Error while waiting for other peers to finish");
 
@@ -117,7 +226,7 @@ int main(int argc, char **argv) {
 
   	// The first data provider adds lambda to its share
   	if(party == 3){
-  		fixed_t lambda_fixed = double_to_fixed(lambda, precision);
+  		fixed_t lambda_fixed = double_to_fixed(opt->lambda, precision);
   		for(size_t i = 0; i < c->d; i++) {
   			share_A[idx(i,i)] += lambda_fixed;
 		}
@@ -131,48 +240,96 @@ int main(int argc, char **argv) {
 		} else {
 			pd = self->peer[0];
 		}
-		orecv(pd, 0, NULL, 0); // flush
-		setCurrentParty(pd, party);
+		// the worker threads of phase 2 split the link to the other party, the
+		// shared memory mesh already has the channels for that
+		if(!mesh) {
+			status = node_open_splits(self, c, opt->threads - 1);
+			check(!status, "Could not open the links for %d threads", opt->threads);
+		}
 		ls.a.d[0] = ls.a.d[1] = ls.b.len = c->d;
 		ls.precision = precision;
 		ls.beta.value = ls.a.value = ls.b.value = NULL;
+		ls.out_of_core_dir = opt->out_of_core_dir;
+		ls.trace = opt->trace;
+		ls.tolerance = opt->tolerance;
+		ls.check_every = opt->check_every;
+		ls.lambda = opt->lambda;
+		ls.lambda_path = opt->lambda_path;
+		ls.lambda_path_len = opt->lambda_path_len;
+		ls.path_iterations = opt->path_iterations;
+		ls.refinement_steps = opt->refinement_steps;
+		ls.threads = opt->threads;
+		ls.hybrid = opt->hybrid;
+		for(size_t k = 0; k < opt->num_subsets; k++) {
+			const subset_t *s = &opt->subsets[k];
+			check(s->cols[s->len - 1] < c->d, "Subset %zd has columns beyond d = %zd", k, c->d);
+		}
+		if(opt->range_analysis) {
+			// the largest lambda on the path bounds the diagonal
+			double max_lambda = opt->lambda;
+			for(size_t i = 0; i < opt->lambda_path_len; i++) {
+				if(opt->lambda_path[i] > max_lambda) max_lambda = opt->lambda_path[i];
+			}
+			ls.a_bits = gram_bound_bits(c, precision, max_lambda);
+		}
+		if(opt->preaggregate) {
+			// collect one aggregate share per CSP/Evaluator before the circuit starts
+			status = recv_preaggregated_shares(self, c, &share_A, &share_b);
+			check(!status, "Could not receive aggregate shares");
+			ls.a.value = (fixed_t *) share_A;
+			ls.b.value = (fixed_t *) share_b;
+			ls.preaggregated = true;
+		}
+		orecv(pd, 0, NULL, 0); // flush
+		setCurrentParty(pd, party);
 		// Run garbled circuit
 		// We'll modify linear.oc so that the inputs are read from a ls if the provided one is not NULL
 		// else we'l use dcrRcvdIntArray...
 		if(party == 2) {
 		      printf("\n");
 		      printf("Algorithm: %s\n", algorithm);
+		      printf("Width: %d\n", fixed_width());
 		}
-		void (*algorithms[])(void *) = {cholesky, ldlt, cgd};
-		int alg_index;
-		if(!strcmp(algorithm, "cholesky")) {
-	              alg_index = 0;
-		} else if (!strcmp(algorithm, "ldlt")) {
-	              alg_index = 1;
+		ls.self = self;
+		ls.input_conn = setup.dcr;
+		if(opt->num_subsets) {
+			subset_args subsets = {&ls, linear_solver_find(algorithm)->solve, opt->subsets, opt->num_subsets};
+			execYaoProtocol(pd, solve_subsets, &subsets);
 		} else {
-		      alg_index = 2;
+			execYaoProtocol(pd, linear_solver_find(algorithm)->solve, &ls);
+		}
+		if(setup.dcr) {
+			dcrClose(setup.dcr);
 		}
-
-		ls.self = self;
-		execYaoProtocol(pd, algorithms[alg_index], &ls);
 
 		if(party == 2) {
 		  //check(ls.beta.len == d, "Computation error.");
 		  printf("Time elapsed: %f\n", wallClock() - time);
 		  printf("Number of gates: %lld\n", ls.gates);
-		  printf("Result: ");
-		  for(size_t i = 0; i < ls.beta.len; i++) {
-		    printf("%20.15f ", fixed_to_double(ls.beta.value[i], precision));
+		  if(!opt->num_subsets) {
+		    printf("Result: ");
+		    for(size_t i = 0; i < ls.beta.len; i++) {
+		      printf("%20.15f ", fixed_to_double(ls.beta.value[i], precision));
+		    }
+		    printf("\n");
 		  }
-		  printf("\n");
+		}
+
+		// the garbled arrays dominate the memory of both parties for large d
+		struct rusage usage;
+		if(!getrusage(RUSAGE_SELF, &usage)) {
+			printf("Party %d garbled array memory: %.1f MB\n", party, ofixed_array_peak_bytes() / 1e6);
+			printf("Party %d peak RSS: %.1f MB\n", party, usage.ru_maxrss / 1e3);
 		}
 
 		if(party == 2) free(ls.beta.value);
 
+	} else if(opt->preaggregate) {
+		status = send_preaggregated_shares(self, c, share_A, share_b);
+		check(!status, "Could not send aggregate shares");
 	} else {
-		printf("party %d connecting to CSP and Evaluator\n", party);
-		DualconS* conn = dcsConnect(self);
-		printf("party %d connected successfully to CSP and Evaluator\n", party);
+		// connected to CSP and Evaluator during phase 1
+		DualconS* conn = setup.dcs;
 		dcsSendIntArray(conn, share_A, c->d*(c->d + 1)/2);
 		dcsSendIntArray(conn, share_b, c->d);
 		dcsClose(conn);
@@ -184,9 +341,186 @@ int main(int argc, char **argv) {
 	free(share_b);
 	return 0;
 error:
+	if(setup_running) {
+		// the setup thread may wait forever for a peer that failed, so we
+		// neither join it nor free the node it uses, it ends when we exit
+		pthread_detach(input_setup);
+		self = NULL;
+	}
 	config_destroy(&c);
 	node_destroy(&self);
 	free(share_A);
 	free(share_b);
 	return 1;
 }
+
+// runs all parties on this host as separate processes, connected through
+// shared memory instead of TCP sockets
+static int run_local(options *opt) {
+	config *c = NULL;
+	shm_mesh *mesh = NULL;
+	pid_t *pid = NULL;
+	int status, failed = 0;
+
+	// we only need the number of parties here, every party reads its own config
+	status = config_new(&c, opt->input_file);
+	check(!status, "Could not read config");
+	int num_parties = c->num_parties;
+	config_destroy(&c);
+
+	mesh = shm_mesh_new(num_parties, opt->threads - 1);
+	check(mesh, "Could not create shared memory mesh");
+	pid = calloc(num_parties, sizeof(pid_t));
+	check(pid, "out of memory");
+
+	fflush(stdout);
+	for(int party = 1; party <= num_parties; party++) {
+		pid[party-1] = fork();
+		check(pid[party-1] >= 0, "fork: %s", strerror(errno));
+		if(!pid[party-1]) {
+			opt->party = party;
+			exit(run_node(opt, mesh));
+		}
+	}
+	for(int party = 1; party <= num_parties; party++) {
+		check(waitpid(pid[party-1], &status, 0) == pid[party-1], "waitpid: %s", strerror(errno));
+		if(!WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "Party %d failed\n", party);
+			failed = 1;
+		}
+	}
+
+	free(pid);
+	shm_mesh_destroy(&mesh);
+	return failed;
+
+error:
+	free(pid);
+	shm_mesh_destroy(&mesh);
+	return 1;
+}
+
+
+int main(int argc, char **argv) {
+	options opt = {0};
+	opt.check_every = 1;
+	opt.threads = 1;
+
+	// parse arguments
+	check(argc > 6, "Usage: %s [Input_file] [Precision] [Party] [Algorithm] [Num. iterations CGD] [Lambda] [Options]\n"
+		"Options: --use_ot: Enables the OT-based phase 1 protocol\n"
+		"         --local: Runs all parties on this host, connected through shared memory ([Party] is ignored)\n"
+		"         --preaggregate: Combines the data providers' shares into two share sets before phase 2\n"
+		"         --width w: Computes with w bit values, a multiple of 8 between 24 and 64 (default: 64)\n"
+		"         --div engine: Division engine, restoring (default) or newton\n"
+		"         --mul engine: Multiplication engine, full (default) or truncated\n"
+		"         --range_analysis: Narrows the garbled values of A to their bound for inputs in [-1,1]\n"
+		"         --out_of_core dir: Keeps the garbled matrix in a memory-mapped file in dir\n"
+		"         --trace level: Intermediate values of cgd revealed per iteration, off, summary, or full (default)\n"
+		"         --tolerance T: Stops cgd once the largest entry of the gradient is below T\n"
+		"         --check_every k: Tests against the tolerance every k iterations (default: 1)\n"
+		"         --lambda_path l1,l2,...: Solves with cgd for [Lambda] and then for each li, starting from the previous solution\n"
+		"         --path_iterations k: Iterations of cgd for each li (default: [Num. iterations CGD])\n"
+		"         --refine k: Refinement steps of ldlt_mixed (default: 3)\n"
+		"         --threads N: Garbles the row kernels of phase 2 on N threads, must be the same for CSP and Evaluator (default: 1)\n"
+		"         --hybrid: Computes p'*A in cgd on arithmetic shares instead of in the garbled circuit\n"
+		"         --subsets c1,c2,...:c1,...: Solves for each subset of columns instead of all of them, after a single phase 1", argv[0]);
+	char *end;
+	opt.input_file = argv[1];
+	opt.precision = (int) strtol(argv[2], &end, 10);
+	check(!errno, "strtol: %s", strerror(errno));
+	check(!*end, "Precision must be a number");
+	opt.party = (int) strtol(argv[3], &end, 10);
+	check(!errno, "strtol: %s", strerror(errno));
+	check(!*end, "Party must be a number");
+	opt.algorithm = argv[4];
+	const linear_solver_t *solver = linear_solver_find(opt.algorithm);
+	check(solver, "Algorithm must be cholesky, cholesky_rsqrt, cholesky_recip, ldlt, ldlt_recip, ldlt_mixed, cgd, cgd_pow2, or cgd_jacobi.");
+	if(solver->iterative){
+	       opt.num_iterations = atoi(argv[5]);
+	} else {
+	       opt.num_iterations = 0;
+	}
+	opt.lambda = (double) strtod(argv[6], &end);
+	check(!errno, "strtod: %s", strerror(errno));
+	check(!*end, "lambda must be a number");
+	
+	// parse options
+	for(int i = 7; i < argc; i++) {
+		if(!strcmp(argv[i], "--use_ot")) {
+			opt.use_ot = true;
+		} else if(!strcmp(argv[i], "--local")) {
+			opt.local = true;
+		} else if(!strcmp(argv[i], "--preaggregate")) {
+			opt.preaggregate = true;
+		} else if(!strcmp(argv[i], "--lambda_path") && i + 1 < argc) {
+			check(!parse_lambda_path(&opt, argv[++i]), "Could not parse --lambda_path");
+		} else if(!strcmp(argv[i], "--subsets") && i + 1 < argc) {
+			check(!subsets_parse(argv[++i], &opt.subsets, &opt.num_subsets), "Could not parse --subsets");
+		} else if(!strcmp(argv[i], "--hybrid")) {
+			opt.hybrid = true;
+		} else if(!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			opt.threads = atoi(argv[++i]);
+			check(opt.threads > 0, "--threads must be positive");
+		} else if(!strcmp(argv[i], "--refine") && i + 1 < argc) {
+			opt.refinement_steps = atoi(argv[++i]);
+			check(opt.refinement_steps > 0, "--refine must be positive");
+		} else if(!strcmp(argv[i], "--path_iterations") && i + 1 < argc) {
+			opt.path_iterations = atoi(argv[++i]);
+			check(opt.path_iterations > 0, "--path_iterations must be positive");
+		} else if(!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+			opt.tolerance = strtod(argv[++i], &end);
+			check(!*end && opt.tolerance > 0, "Tolerance must be a positive number");
+		} else if(!strcmp(argv[i], "--check_every") && i + 1 < argc) {
+			opt.check_every = atoi(argv[++i]);
+			check(opt.check_every > 0, "--check_every must be positive");
+		} else if(!strcmp(argv[i], "--trace") && i + 1 < argc) {
+			char *level = argv[++i];
+			if(!strcmp(level, "off")) {
+				opt.trace = TRACE_OFF;
+			} else if(!strcmp(level, "summary")) {
+				opt.trace = TRACE_SUMMARY;
+			} else {
+				check(!strcmp(level, "full"), "Trace level must be off, summary, or full");
+				opt.trace = TRACE_FULL;
+			}
+		} else if(!strcmp(argv[i], "--out_of_core") && i + 1 < argc) {
+			opt.out_of_core_dir = argv[++i];
+		} else if(!strcmp(argv[i], "--range_analysis")) {
+			opt.range_analysis = true;
+		} else if(!strcmp(argv[i], "--width") && i + 1 < argc) {
+			int width = atoi(argv[++i]);
+			check(fixed_set_width(width), "Unsupported width %d", width);
+		} else if(!strcmp(argv[i], "--div") && i + 1 < argc) {
+			char *engine = argv[++i];
+			check(!strcmp(engine, "restoring") || !strcmp(engine, "newton"),
+				"Division engine must be restoring or newton");
+			check(ofixed_set_div_engine(strcmp(engine, "newton") ? OFIXED_DIV_RESTORING : OFIXED_DIV_NEWTON),
+				"Division engine %s is not supported by this backend", engine);
+		} else if(!strcmp(argv[i], "--mul") && i + 1 < argc) {
+			char *engine = argv[++i];
+			check(!strcmp(engine, "full") || !strcmp(engine, "truncated"),
+				"Multiplication engine must be full or truncated");
+			check(ofixed_set_mul_engine(strcmp(engine, "truncated") ? OFIXED_MUL_FULL : OFIXED_MUL_TRUNCATED),
+				"Multiplication engine %s is not supported by this backend", engine);
+		}
+	}
+
+	if(opt.lambda_path_len) {
+		check(solver->iterative, "--lambda_path requires an iterative algorithm");
+		if(!opt.path_iterations) opt.path_iterations = opt.num_iterations;
+	}
+	check(!opt.hybrid || solver->iterative, "--hybrid requires an iterative algorithm");
+	check(opt.precision >= 0 && opt.precision + MIN_INTEGER_BITS <= fixed_width(),
+		"Precision must leave at least %d integer bits of the width %d", MIN_INTEGER_BITS, fixed_width());
+
+	int ret = opt.local ? run_local(&opt) : run_node(&opt, NULL);
+	free(opt.lambda_path);
+	subsets_free(opt.subsets, opt.num_subsets);
+	return ret;
+
+error:
+	free(opt.lambda_path);
+	subsets_free(opt.subsets, opt.num_subsets);
+	return 1;
+}
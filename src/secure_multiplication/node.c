@@ -1,6 +1,7 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <stdbool.h>
 
 #include "node.h"
 #include "obliv.h"
@@ -8,9 +9,116 @@
 #include "check_error.h"
 #include "util.h"
 
+// connects to the peer listening on endpoint and announces ourselves as 'announce'
+static int connect_peer(ProtocolDesc **pd, const char *endpoint, int announce) {
+	char *host = strdup(endpoint);
+	check(host, "out of memory");
+	char* port = strchr(host, ':');
+	*(port++) = '\0'; // split endpoint at ':'
+	*pd = malloc(sizeof(ProtocolDesc));
+	check(*pd, "out of memory");
+	util_loop_connect(*pd, host, port);
+	free(host);
+	host = NULL;
+	check(osend(*pd, 0, &announce, sizeof(announce)) == sizeof(announce),
+		"Party %d: osend: %s", announce, strerror(errno)); // announce ourselves
+	orecv(*pd,0,NULL,0); // flush
+	return 0;
+
+error:
+	free(host);
+	return 1;
+}
+
+// whether parties a and b (1-based) need a link for phase 2 input
+static bool has_input_link(int a, int b) {
+	return (a < 3) != (b < 3);
+}
+
+// Transport of the link between the CSP and Evaluator once split links are
+// open. It forwards to the TCP transport of the link, and its splits forward
+// to one of the split links that is not in use. Both parties split and clean
+// up in the same order, so they pick the same one.
+typedef struct split_transport split_transport;
+struct split_transport {
+	ProtocolTransport cb;
+	ProtocolTransport *inner;
+	node *n;
+	bool *split_used; // only for the main link
+	split_transport *parent; // the main link this one was split from, or NULL
+	int index; // of the split link
+};
+
+static split_transport *split_transport_new(node *n, ProtocolTransport *inner, split_transport *parent, int index);
+
+static int split_send(ProtocolTransport *pt, int dest, const void *s, size_t n) {
+	ProtocolTransport *inner = ((split_transport *) pt)->inner;
+	return inner->send(inner, dest, s, n);
+}
+
+static int split_recv(ProtocolTransport *pt, int src, void *s, size_t n) {
+	ProtocolTransport *inner = ((split_transport *) pt)->inner;
+	return inner->recv(inner, src, s, n);
+}
+
+static int split_flush(ProtocolTransport *pt) {
+	ProtocolTransport *inner = ((split_transport *) pt)->inner;
+	return inner->flush(inner);
+}
+
+// the split links themselves stay open for the next split, node_destroy closes them
+static void split_cleanup(ProtocolTransport *pt) {
+	split_transport *t = (split_transport *) pt;
+	if(t->parent) {
+		t->inner->flush(t->inner);
+		t->parent->split_used[t->index] = false;
+	} else {
+		t->inner->cleanup(t->inner);
+	}
+	free(t->split_used);
+	free(t);
+}
+
+static ProtocolTransport *split_split(ProtocolTransport *pt) {
+	split_transport *t = (split_transport *) pt;
+	if(!t->split_used) return NULL;
+	for(int k = 0; k < t->n->splits; k++) {
+		if(t->split_used[k]) continue;
+		split_transport *split = split_transport_new(t->n, t->n->split_peer[k]->trans, t, k);
+		if(!split) return NULL;
+		t->split_used[k] = true;
+		return &split->cb;
+	}
+	return NULL;
+}
+
+static split_transport *split_transport_new(node *n, ProtocolTransport *inner, split_transport *parent, int index) {
+	split_transport *t = malloc(sizeof(split_transport));
+	if(!t) return NULL;
+	t->cb = (ProtocolTransport) {
+		.maxParties = inner->maxParties,
+		.split = split_split,
+		.send = split_send,
+		.recv = split_recv,
+		.flush = split_flush,
+		.cleanup = split_cleanup
+	};
+	t->inner = inner;
+	t->n = n;
+	t->parent = parent;
+	t->index = index;
+	t->split_used = NULL;
+	if(!parent) {
+		t->split_used = calloc(n->splits, sizeof(bool));
+		if(!t->split_used) {
+			free(t);
+			return NULL;
+		}
+	}
+	return t;
+}
+
 int node_new(node **nn, config *conf) {
-	int status;
-	char *host = NULL;
 	check(nn && conf, "node_new: Arguments may not be null");
 
 	*nn = malloc(sizeof(node));
@@ -20,33 +128,39 @@ int node_new(node **nn, config *conf) {
 	n->party = conf->party;
 	n->peer = calloc(n->num_parties, sizeof(ProtocolDesc *));
 	check(n->peer, "out of memory");
+	n->input_peer = calloc(n->num_parties, sizeof(ProtocolDesc *));
+	check(n->input_peer, "out of memory");
+	n->split_peer = NULL;
+	n->splits = 0;
 	
 	int i;
 	// other peer is listening -> connect
 	for(i = 0; i < n->party - 1; i++) {
-		host = strdup(conf->endpoint[i]);
-		check(host, "out of memory");
-		char* port = strchr(host, ':');
-		*(port++) = '\0'; // split endpoint at ':'
-		n->peer[i] = malloc(sizeof(ProtocolDesc));
-		check(n->peer[i], "out of memory");
-		util_loop_connect(n->peer[i], host, port);
-		free(host);
-		check(osend(n->peer[i], 0, &(n->party), sizeof(n->party)) == sizeof(n->party),
-			"Party %d: osend: %s", n->party, strerror(errno)); // announce ourselves
-		orecv(n->peer[i],0,NULL,0); // flush
+		check(!connect_peer(&n->peer[i], conf->endpoint[i], n->party),
+			"Party %d: Could not connect to party %d", n->party, i+1);
+	}
+	// input links are announced with the negated party number
+	for(i = 0; i < n->party - 1; i++) {
+		if(has_input_link(n->party, i+1)) {
+			check(!connect_peer(&n->input_peer[i], conf->endpoint[i], -n->party),
+				"Party %d: Could not connect to party %d", n->party, i+1);
+		}
 	}
 
 	// open our own listening socket
 	int listen_sock;
-	check(i == n->party - 1, "WAT");
+	i = n->party - 1;
 	n->peer[i] = NULL;
 	char* port = strchr(conf->endpoint[i], ':') +1;
 	listen_sock = tcpListenAny(port);
 	check(listen_sock >= 0, "Could not create listen socket");
 
 	// accept incoming connections from peers
-	for(i = n->party; i < n->num_parties; i++) { 
+	int incoming = n->num_parties - n->party;
+	for(i = n->party; i < n->num_parties; i++) {
+		incoming += has_input_link(n->party, i+1);
+	}
+	for(i = 0; i < incoming; i++) {
 		ProtocolDesc *pd = malloc(sizeof(ProtocolDesc));
 		check(pd, "out of memory");
 		int sock = accept(listen_sock, NULL, NULL);
@@ -54,31 +168,154 @@ int node_new(node **nn, config *conf) {
 		int other;
 		check(orecv(pd, 0, &other, sizeof(other)) == sizeof(other), 
 			"Party %d: orecv: %s", n->party, strerror(errno));
-		check(other > n->party && other <= n->num_parties, 
+		ProtocolDesc **peer = other > 0 ? n->peer : n->input_peer;
+		other = other > 0 ? other : -other;
+		check(other > n->party && other <= n->num_parties &&
+			(peer == n->peer || has_input_link(n->party, other)),
 			"Party %d received invalid party number %d from remote", n->party, other);
-		check(n->peer[other-1] == NULL, 
+		check(peer[other-1] == NULL, 
 			"Duplicate party %d", other);
-		n->peer[other-1] = pd;
+		peer[other-1] = pd;
 	}
 	close(listen_sock);
 	return 0;
 
 error:
-	free(host);
 	if(nn) node_destroy(nn);
 	return 1;
 }
 
+int node_new_shm(node **nn, config *conf, shm_mesh *mesh) {
+	ProtocolDesc *pd = NULL;
+	check(nn && conf && mesh, "node_new_shm: Arguments may not be null");
+
+	*nn = malloc(sizeof(node));
+	check(*nn, "out of memory");
+	node *n = *nn;
+	n->num_parties = conf->num_parties;
+	n->party = conf->party;
+	n->peer = calloc(n->num_parties, sizeof(ProtocolDesc *));
+	check(n->peer, "out of memory");
+	n->input_peer = calloc(n->num_parties, sizeof(ProtocolDesc *));
+	check(n->input_peer, "out of memory");
+	n->split_peer = NULL;
+	n->splits = 0;
+
+	for(int i = 0; i < n->num_parties; i++) {
+		if(i == n->party - 1) {
+			continue;
+		}
+		pd = malloc(sizeof(ProtocolDesc));
+		check(pd, "out of memory");
+		check(!shm_connect(pd, mesh, SHM_CHANNEL_MAIN, n->party, i+1),
+			"Party %d: Could not connect to party %d", n->party, i+1);
+		n->peer[i] = pd;
+		pd = NULL;
+		if(has_input_link(n->party, i+1)) {
+			pd = malloc(sizeof(ProtocolDesc));
+			check(pd, "out of memory");
+			check(!shm_connect(pd, mesh, SHM_CHANNEL_INPUT, n->party, i+1),
+				"Party %d: Could not connect to party %d", n->party, i+1);
+			n->input_peer[i] = pd;
+			pd = NULL;
+		}
+	}
+	return 0;
+
+error:
+	free(pd);
+	if(nn) node_destroy(nn);
+	return 1;
+}
+
+int node_open_splits(node *n, config *conf, int splits) {
+	int listen_sock = -1;
+	split_transport *t = NULL;
+	check(n && conf && !n->split_peer, "node_open_splits: Invalid arguments");
+	if(n->party > 2) {
+		return 0;
+	}
+	// the CSP's link to the Evaluator is peer[1], the Evaluator's to the CSP peer[0]
+	ProtocolDesc *pd = n->peer[2 - n->party];
+	int other_splits;
+	check(osend(pd, 0, &splits, sizeof(splits)) == sizeof(splits),
+		"Party %d: osend: %s", n->party, strerror(errno));
+	orecv(pd, 0, NULL, 0); // flush
+	check(orecv(pd, 0, &other_splits, sizeof(other_splits)) == sizeof(other_splits),
+		"Party %d: orecv: %s", n->party, strerror(errno));
+	check(other_splits == splits, "Party %d uses %d threads, but party %d uses %d threads",
+		n->party, splits + 1, 3 - n->party, other_splits + 1);
+	if(splits < 1) {
+		return 0;
+	}
+
+	n->split_peer = calloc(splits, sizeof(ProtocolDesc *));
+	check(n->split_peer, "out of memory");
+	n->splits = splits;
+	if(n->party == 2) {
+		// split links are announced with their index
+		for(int k = 0; k < splits; k++) {
+			check(!connect_peer(&n->split_peer[k], conf->endpoint[0], k),
+				"Party 2: Could not open split link %d to party 1", k);
+		}
+	} else {
+		// the CSP listens on its endpoint once more
+		char* port = strchr(conf->endpoint[0], ':') +1;
+		listen_sock = tcpListenAny(port);
+		check(listen_sock >= 0, "Could not create listen socket");
+		for(int i = 0; i < splits; i++) {
+			int sock = accept(listen_sock, NULL, NULL);
+			check(sock >= 0, "Party 1: accept: %s", strerror(errno));
+			ProtocolDesc *split = malloc(sizeof(ProtocolDesc));
+			if(!split) {
+				close(sock);
+				check(false, "out of memory");
+			}
+			protocolUseTcp2P(split, sock, false);
+			int k;
+			if(orecv(split, 0, &k, sizeof(k)) != sizeof(k) || k < 0 || k >= splits || n->split_peer[k]) {
+				cleanupProtocol(split);
+				free(split);
+				check(false, "Party 1 received an invalid split link");
+			}
+			n->split_peer[k] = split;
+		}
+		close(listen_sock);
+		listen_sock = -1;
+	}
+
+	t = split_transport_new(n, pd->trans, NULL, 0);
+	check(t, "out of memory");
+	pd->trans = &t->cb;
+	return 0;
+
+error:
+	if(listen_sock >= 0) close(listen_sock);
+	return 1;
+}
+
 void node_destroy(node **nn) {
 	if(nn && *nn) {
 		node *n = *nn;
 		for(int i = 0; i < n->num_parties; i++) {
-			if(n->peer[i]) {
+			if(n->peer && n->peer[i]) {
 				cleanupProtocol(n->peer[i]);			
 				free(n->peer[i]);
 			}
+			if(n->input_peer && n->input_peer[i]) {
+				cleanupProtocol(n->input_peer[i]);
+				free(n->input_peer[i]);
+			}
+		}
+		for(int k = 0; n->split_peer && k < n->splits; k++) {
+			if(n->split_peer[k]) {
+				cleanupProtocol(n->split_peer[k]);
+				free(n->split_peer[k]);
+			}
 		}
 		free(n->peer);
+		free(n->input_peer);
+		free(n->split_peer);
 		free(n);
 		*nn = NULL;
 	}
@@ -1,13 +1,31 @@
 #pragma once
 #include "obliv.h"
 #include "config.h"
+#include "shm.h"
 
 typedef struct node {
 	int party;
 	int num_parties;
 	ProtocolDesc **peer;
+	// separate links between the data providers and the CSP and Evaluator,
+	// reserved for phase 2 input so it can be set up while phase 1 is running.
+	// Only the entries for these pairs are set.
+	ProtocolDesc **input_peer;
+	// further TCP links between the CSP and Evaluator, which ocSplitProto on
+	// their link in peer hands out, see node_open_splits
+	ProtocolDesc **split_peer;
+	int splits;
 } node;
 
 int node_new(node **n, config *conf);
 
+// like node_new, but connects to all peers through the shared memory mesh
+int node_new_shm(node **n, config *conf, shm_mesh *mesh);
+
+// Opens 'splits' more TCP links between the CSP and Evaluator, so that their
+// link in peer can be split that many times at once by ocSplitProto, e.g. for
+// the worker threads of phase 2. The two exchange their number of splits
+// first, and fail if it differs. Does nothing for the data providers.
+int node_open_splits(node *n, config *conf, int splits);
+
 void node_destroy(node **n);
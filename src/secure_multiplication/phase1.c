@@ -38,11 +38,12 @@ typedef struct {
 	ufixed_t *x;
 	size_t n;
 	size_t stride_x;
+	int width; // only the lowest bits of x matter modulo 2^width
 } inner_product_args;
 void inner_product_correlator(char *a1, const char *a2, int ni, void *vargs) {
 	inner_product_args *args = vargs;
-	size_t k = ni / FIXED_BIT_SIZE;
-	int i = ni % FIXED_BIT_SIZE;
+	size_t k = ni / args->width;
+	int i = ni % args->width;
 	ufixed_t b = args->x[k * args->stride_x];
 	ufixed_t *result = (ufixed_t *) a1;
 	ufixed_t s_i = *((ufixed_t *) a2);
@@ -51,18 +52,19 @@ void inner_product_correlator(char *a1, const char *a2, int ni, void *vargs) {
 
 ufixed_t inner_product_ot_sender(struct HonestOTExtSender *sender, ufixed_t *x, size_t n, size_t stride_x) {
 	ufixed_t result = 0;
-	ufixed_t *s = malloc(n * FIXED_BIT_SIZE * sizeof(ufixed_t));
-	ufixed_t *t = malloc(n * FIXED_BIT_SIZE * sizeof(ufixed_t));
-	inner_product_args args = {.x = x, .n = n, .stride_x = stride_x};
+	int width = fixed_width();
+	ufixed_t *s = malloc(n * width * sizeof(ufixed_t));
+	ufixed_t *t = malloc(n * width * sizeof(ufixed_t));
+	inner_product_args args = {.x = x, .n = n, .stride_x = stride_x, .width = width};
 	honestCorrelatedOTExtSend1Of2(sender,
 		(char *) s,
 		(char *) t,
-		FIXED_BIT_SIZE * n,
+		width * n,
 		sizeof(ufixed_t),
 		inner_product_correlator,
 		&args
 	);
-	for(size_t i = 0; i < n * FIXED_BIT_SIZE; i++) {
+	for(size_t i = 0; i < n * width; i++) {
 		result -= s[i];
 	}
 	free(s);
@@ -72,21 +74,22 @@ ufixed_t inner_product_ot_sender(struct HonestOTExtSender *sender, ufixed_t *x,
 
 ufixed_t inner_product_ot_recver(struct HonestOTExtRecver *recvr, ufixed_t *x, size_t n, size_t stride_x) {
 	ufixed_t result = 0;
-	ufixed_t *t = malloc(n * FIXED_BIT_SIZE * sizeof(ufixed_t));
-	bool *sel = malloc(n * FIXED_BIT_SIZE * sizeof(bool));
+	int width = fixed_width();
+	ufixed_t *t = malloc(n * width * sizeof(ufixed_t));
+	bool *sel = malloc(n * width * sizeof(bool));
 	for(size_t k = 0; k < n; k++) {
 		ufixed_t a = x[k * stride_x];
-		for(int i = 0; i < FIXED_BIT_SIZE; i++) {
-			sel[k * FIXED_BIT_SIZE + i] = (a >> i) & 1;
+		for(int i = 0; i < width; i++) {
+			sel[k * width + i] = (a >> i) & 1;
 		}
 	}
 	honestCorrelatedOTExtRecv1Of2(recvr,
 		(char *) t,
 		sel,
-		FIXED_BIT_SIZE * n,
+		width * n,
 		sizeof(ufixed_t)
 	);
-	for(size_t i = 0; i < n * FIXED_BIT_SIZE; i++) {
+	for(size_t i = 0; i < n * width; i++) {
 		result += t[i];
 	}
 	free(t);
@@ -611,3 +614,81 @@ error:
 	free(share_b);
 	return 1;
 }
+
+
+int send_preaggregated_shares(node *self, config *c, ufixed_t *share_A, ufixed_t *share_b) {
+	BCipherRandomGen *gen = newBCipherRandomGen();
+	int status;
+	size_t d = c->d;
+	ufixed_t *mask = malloc((d * (d + 1) / 2) * sizeof(ufixed_t));
+	ufixed_t *masked = malloc((d * (d + 1) / 2) * sizeof(ufixed_t));
+	check(mask && masked, "malloc: %s", strerror(errno));
+	SecureMultiplication__Msg pmsg_out;
+	secure_multiplication__msg__init(&pmsg_out);
+
+	// send (A - r_A, b - r_b) to the CSP and (r_A, r_b) to the Evaluator
+	ufixed_t *shares[] = {share_A, share_b};
+	size_t len[] = {d * (d + 1) / 2, d};
+	for(int k = 0; k < 2; k++) {
+		randomizeBuffer(gen, (char *) mask, len[k] * sizeof(ufixed_t));
+		for(size_t i = 0; i < len[k]; i++) {
+			masked[i] = shares[k][i] - mask[i];
+		}
+		pmsg_out.n_vector = len[k];
+		pmsg_out.vector = masked;
+		status = send_pmsg(&pmsg_out, self->peer[0]);
+		check(!status, "Could not send masked share to CSP");
+		pmsg_out.vector = mask;
+		status = send_pmsg(&pmsg_out, self->peer[1]);
+		check(!status, "Could not send mask to Evaluator");
+	}
+
+	free(mask);
+	free(masked);
+	releaseBCipherRandomGen(gen);
+	return 0;
+
+error:
+	free(mask);
+	free(masked);
+	releaseBCipherRandomGen(gen);
+	return 1;
+}
+
+int recv_preaggregated_shares(node *self, config *c, ufixed_t **res_A, ufixed_t **res_b) {
+	int status;
+	size_t d = c->d;
+	SecureMultiplication__Msg *pmsg_in = NULL;
+	ufixed_t *share_A = calloc(d * (d + 1) / 2, sizeof(ufixed_t));
+	ufixed_t *share_b = calloc(d, sizeof(ufixed_t));
+	check(share_A && share_b, "malloc: %s", strerror(errno));
+
+	for(int p = 2; p < c->num_parties; p++) {
+		status = recv_pmsg(&pmsg_in, self->peer[p]);
+		check(!status, "Could not receive aggregate share of A from peer %d", p+1);
+		check(pmsg_in->n_vector == d * (d + 1) / 2, "Invalid share of A from peer %d", p+1);
+		for(size_t i = 0; i < d * (d + 1) / 2; i++) {
+			share_A[i] += pmsg_in->vector[i];
+		}
+		secure_multiplication__msg__free_unpacked(pmsg_in, NULL);
+		status = recv_pmsg(&pmsg_in, self->peer[p]);
+		check(!status, "Could not receive aggregate share of b from peer %d", p+1);
+		check(pmsg_in->n_vector == d, "Invalid share of b from peer %d", p+1);
+		for(size_t i = 0; i < d; i++) {
+			share_b[i] += pmsg_in->vector[i];
+		}
+		secure_multiplication__msg__free_unpacked(pmsg_in, NULL);
+		pmsg_in = NULL;
+	}
+
+	*res_A = share_A;
+	*res_b = share_b;
+	return 0;
+
+error:
+	secure_multiplication__msg__free_unpacked(pmsg_in, NULL);
+	free(share_A);
+	free(share_b);
+	*res_A = *res_b = NULL;
+	return 1;
+}
@@ -26,3 +26,20 @@ int run_party(
   ufixed_t **res_b,
   bool use_ot
 );
+
+// Re-shares our shares of A and b as (share - r, r) for a fresh random r and
+// sends the first part to the CSP and the second one to the Evaluator
+int send_preaggregated_shares(
+  node *self,
+  config *c,
+  ufixed_t *share_A,
+  ufixed_t *share_b
+);
+// Receives the re-shared shares of all data providers and sums them up,
+// so that the CSP and the Evaluator each end up with a single share set
+int recv_preaggregated_shares(
+  node *self,
+  config *c,
+  ufixed_t **res_A,
+  ufixed_t **res_b
+);
@@ -47,7 +47,8 @@ int main(int argc, char **argv) {
 	wait_total.tv_sec = wait_total.tv_nsec = 0;
 
 	// parse arguments
-	check(argc > 3, "Usage: %s file precision party [options]\nOptions: --use_ot: Enables the OT-based phase 1 protocol", argv[0]);
+	check(argc > 3, "Usage: %s file precision party [options]\nOptions: --use_ot: Enables the OT-based phase 1 protocol\n"
+		"         --width w: Computes shares modulo 2^w", argv[0]);
 	char *end;
 	int precision = (int) strtol(argv[2], &end, 10);
 	check(!errno, "strtol: %s", strerror(errno));
@@ -62,6 +63,9 @@ int main(int argc, char **argv) {
 	for(int i = 4; i < argc; i++) {
 		if(!strcmp(argv[i], "--use_ot")) {
 			use_ot = true;
+		} else if(!strcmp(argv[i], "--width") && i + 1 < argc) {
+			int width = atoi(argv[++i]);
+			check(fixed_set_width(width), "Unsupported width %d", width);
 		}
 	}
 
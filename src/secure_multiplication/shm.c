@@ -0,0 +1,188 @@
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "shm.h"
+#include "obliv_common.h"
+#include "check_error.h"
+
+// capacity of a single ring in bytes, must be a power of two
+#define SHM_RING_SIZE (1 << 20)
+
+typedef struct {
+	_Alignas(64) atomic_size_t head; // bytes written so far, only modified by the sender
+	_Alignas(64) atomic_size_t tail; // bytes read so far, only modified by the receiver
+	_Alignas(64) char data[SHM_RING_SIZE];
+} shm_ring;
+
+struct shm_mesh {
+	int num_parties;
+	int channels; // SHM_CHANNELS and the ones for splits
+	size_t size; // size of the mapping in bytes
+	shm_ring ring[]; // ring[(channel * num_parties + from) * num_parties + to], 0-based party indices
+};
+
+typedef struct shm_transport shm_transport;
+struct shm_transport {
+	ProtocolTransport cb;
+	shm_ring *out, *in;
+	shm_mesh *mesh;
+	int self, other;
+	int channel;
+	shm_transport *parent; // the main link this one was split from, or NULL
+	bool *split_used; // split channels in use, only for SHM_CHANNEL_MAIN
+};
+
+static shm_transport *shm_transport_new(shm_mesh *mesh, int channel, int self, int other);
+
+static size_t min_size(size_t a, size_t b) {
+	return a < b ? a : b;
+}
+
+static int shm_send(ProtocolTransport *pt, int dest, const void *s, size_t n) {
+	shm_ring *r = ((shm_transport *) pt)->out;
+	const char *src = s;
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t sent = 0;
+	while(sent < n) {
+		size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+		size_t space = SHM_RING_SIZE - (head - tail);
+		if(!space) {
+			sched_yield(); // receiver is behind
+			continue;
+		}
+		size_t offset = head & (SHM_RING_SIZE - 1);
+		size_t len = min_size(min_size(n - sent, space), SHM_RING_SIZE - offset);
+		memcpy(r->data + offset, src + sent, len);
+		head += len;
+		sent += len;
+		atomic_store_explicit(&r->head, head, memory_order_release);
+	}
+	return n;
+}
+
+static int shm_recv(ProtocolTransport *pt, int src, void *s, size_t n) {
+	shm_ring *r = ((shm_transport *) pt)->in;
+	char *dest = s;
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t received = 0;
+	while(received < n) {
+		size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+		size_t available = head - tail;
+		if(!available) {
+			sched_yield(); // sender is behind
+			continue;
+		}
+		size_t offset = tail & (SHM_RING_SIZE - 1);
+		size_t len = min_size(min_size(n - received, available), SHM_RING_SIZE - offset);
+		memcpy(dest + received, r->data + offset, len);
+		tail += len;
+		received += len;
+		atomic_store_explicit(&r->tail, tail, memory_order_release);
+	}
+	return n;
+}
+
+// writes are visible to the receiver immediately, there is nothing to flush
+static int shm_flush(ProtocolTransport *pt) {
+	return 0;
+}
+
+static void shm_cleanup(ProtocolTransport *pt) {
+	shm_transport *t = (shm_transport *) pt;
+	if(t->parent) {
+		t->parent->split_used[t->channel - SHM_CHANNELS] = false;
+	}
+	free(t->split_used);
+	free(t);
+}
+
+// Takes the lowest split channel that is not in use. Both parties split and
+// clean up their ends of a main link in the same order, so they pick the same
+// channel. The rings of a cleaned up split are empty, so they can be reused.
+static ProtocolTransport *shm_split(ProtocolTransport *pt) {
+	shm_transport *t = (shm_transport *) pt;
+	if(!t->split_used) return NULL;
+	for(int k = 0; SHM_CHANNELS + k < t->mesh->channels; k++) {
+		if(t->split_used[k]) continue;
+		shm_transport *split = shm_transport_new(t->mesh, SHM_CHANNELS + k, t->self, t->other);
+		if(!split) return NULL;
+		split->parent = t;
+		t->split_used[k] = true;
+		return &split->cb;
+	}
+	return NULL;
+}
+
+static shm_transport *shm_transport_new(shm_mesh *mesh, int channel, int self, int other) {
+	shm_transport *t = malloc(sizeof(shm_transport));
+	if(!t) return NULL;
+	t->cb = (ProtocolTransport) {
+		.maxParties = 2,
+		.split = shm_split,
+		.send = shm_send,
+		.recv = shm_recv,
+		.flush = shm_flush,
+		.cleanup = shm_cleanup
+	};
+	shm_ring *ring = &mesh->ring[channel * mesh->num_parties * mesh->num_parties];
+	t->out = &ring[(self-1) * mesh->num_parties + (other-1)];
+	t->in = &ring[(other-1) * mesh->num_parties + (self-1)];
+	t->mesh = mesh;
+	t->self = self;
+	t->other = other;
+	t->channel = channel;
+	t->parent = NULL;
+	t->split_used = NULL;
+	if(channel == SHM_CHANNEL_MAIN && mesh->channels > SHM_CHANNELS) {
+		t->split_used = calloc(mesh->channels - SHM_CHANNELS, sizeof(bool));
+		if(!t->split_used) {
+			free(t);
+			return NULL;
+		}
+	}
+	return t;
+}
+
+shm_mesh *shm_mesh_new(int num_parties, int splits) {
+	int channels = SHM_CHANNELS + splits;
+	size_t size = sizeof(shm_mesh) + (size_t) channels * num_parties * num_parties * sizeof(shm_ring);
+	shm_mesh *mesh = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	check(mesh != MAP_FAILED, "mmap: %s", strerror(errno));
+	// anonymous mappings are zero-filled, so all rings start out empty
+	mesh->num_parties = num_parties;
+	mesh->channels = channels;
+	mesh->size = size;
+	return mesh;
+
+error:
+	return NULL;
+}
+
+void shm_mesh_destroy(shm_mesh **mesh) {
+	if(mesh && *mesh) {
+		munmap(*mesh, (*mesh)->size);
+		*mesh = NULL;
+	}
+}
+
+int shm_connect(ProtocolDesc *pd, shm_mesh *mesh, int channel, int self, int other) {
+	check(pd && mesh, "shm_connect: Arguments may not be null");
+	check(channel >= 0 && channel < SHM_CHANNELS, "shm_connect: Invalid channel %d", channel);
+	check(self != other && self > 0 && other > 0 &&
+		self <= mesh->num_parties && other <= mesh->num_parties,
+		"shm_connect: Invalid link %d -> %d", self, other);
+	shm_transport *t = shm_transport_new(mesh, channel, self, other);
+	check(t, "out of memory");
+	memset(pd, 0, sizeof(ProtocolDesc));
+	pd->trans = &t->cb;
+	return 0;
+
+error:
+	return 1;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "obliv.h"
+
+// A mesh of lock-free single-producer/single-consumer ring buffers, one for
+// each ordered pair of parties. The mesh lives in anonymous shared memory, so
+// it can be used by parties running as threads of one process as well as by
+// processes forked after it was created.
+typedef struct shm_mesh shm_mesh;
+
+// every pair of parties can have several independent links
+#define SHM_CHANNEL_MAIN 0
+#define SHM_CHANNEL_INPUT 1 // see node.input_peer
+#define SHM_CHANNELS 2
+
+// 'splits' further channels per pair are reserved for ocSplitProto on the
+// main links, e.g. for the worker threads of phase 2
+shm_mesh *shm_mesh_new(int num_parties, int splits);
+
+void shm_mesh_destroy(shm_mesh **mesh);
+
+// makes pd use the given link between parties 'self' and 'other' (1-based)
+// as its transport, instead of a TCP socket
+int shm_connect(ProtocolDesc *pd, shm_mesh *mesh, int channel, int self, int other);
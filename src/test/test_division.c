@@ -0,0 +1,96 @@
+#include <obliv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "test/test_division.h"
+#include "util.h"
+#include "check_error.h"
+
+// Compares the gate count and accuracy of the division engines.
+// Both parties generate the same operands, so that party 1 can compute the
+// exact quotients. Party 1 fails if an engine is off by more than its bound.
+
+const int len = 100;
+
+// largest error in units in the last place: restoring division is exact,
+// Newton-Raphson may differ from the truncated quotient in the last few bits
+const double max_ulp[2] = {0, 4};
+
+int main(int argc, char **argv) {
+	ProtocolDesc pd;
+	divisionIO io = {0};
+	int ret = 1;
+
+	check(argc >= 4, "Usage: %s Port Party Width", argv[0]);
+
+	// read party
+	int party = 0;
+	if(!strcmp(argv[2], "1")) {
+		party = 1;
+	} else if(!strcmp(argv[2], "2")) {
+		party = 2;
+	}
+	check(party > 0, "Party must be either 1 or 2.");
+	int width = atoi(argv[3]);
+	check(fixed_set_width(width), "Unsupported width %d", width);
+
+	// operands in [-4, 4) divided by +-[1/4, 4), quotients stay below 16
+	io.p = width / 2;
+	io.len = len;
+	io.num = malloc(io.len * sizeof(fixed_t));
+	io.den = malloc(io.len * sizeof(fixed_t));
+	io.engine[0].name = "restoring";
+	io.engine[1].name = "newton";
+	for(int e = 0; e < 2; e++) {
+		io.engine[e].result = malloc(io.len * sizeof(fixed_t));
+	}
+	srand(42);
+	for(size_t i = 0; i < io.len; i++) {
+		double a = 8.0 * rand() / RAND_MAX - 4.0;
+		double b = ldexp(1.0 + (double) rand() / RAND_MAX, rand() % 4 - 2);
+		io.num[i] = double_to_fixed(a, io.p);
+		io.den[i] = double_to_fixed(rand() % 2 ? b : -b, io.p);
+	}
+
+	ocTestUtilTcpOrDie(&pd, party==1, argv[1]);
+	setCurrentParty(&pd, party);
+	execYaoProtocol(&pd, test_division, &io);
+	cleanupProtocol(&pd);
+
+	bool passed = true;
+	if(party == 1) {
+		printf("width %d, precision %d\n", width, io.p);
+		printf("%-10s %12s %16s %16s\n", "engine", "gates/div", "max error (ulp)", "mean error (ulp)");
+		for(int e = 0; e < 2; e++) {
+			if(io.engine[e].gates < 0) {
+				printf("%-10s not supported by this backend\n", io.engine[e].name);
+				continue;
+			}
+			double max_error = 0, total_error = 0;
+			for(size_t i = 0; i < io.len; i++) {
+				// exact quotient, truncated towards zero
+				fixed_t exact = (fixed_t) (((__int128) io.num[i] << io.p) / io.den[i]);
+				double error = fabs((double) io.engine[e].result[i] - (double) exact);
+				max_error = error > max_error ? error : max_error;
+				total_error += error;
+			}
+			printf("%-10s %12lld %16.1f %16.2f\n", io.engine[e].name, io.engine[e].gates,
+				max_error, total_error / io.len);
+			if(max_error > max_ulp[e]) {
+				fprintf(stderr, "%s: max error %.1f ulp exceeds %.1f ulp\n", io.engine[e].name,
+					max_error, max_ulp[e]);
+				passed = false;
+			}
+		}
+	}
+	ret = !passed;
+
+error:
+	free(io.num);
+	free(io.den);
+	for(int e = 0; e < 2; e++) {
+		free(io.engine[e].result);
+	}
+	return ret;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "fixed.h"
+
+// results of one division engine
+typedef struct {
+	const char *name;
+	long long gates; // per division
+	fixed_t *result;
+} divisionEngineIO;
+
+typedef struct divisionIO {
+	fixed_t *num, *den;
+	size_t len;
+	int p;
+	divisionEngineIO engine[2]; // OFIXED_DIV_RESTORING, OFIXED_DIV_NEWTON
+} divisionIO;
+
+void test_division(void *v);
@@ -1,5 +1,6 @@
 #include <obliv.h>
 #include <stdio.h>
+#include <string.h>
 #include "test/test_fixed.h"
 #include "util.h"
 #include "check_error.h"
@@ -14,7 +15,7 @@ int main(int argc, char **argv) {
 	int ret = 1;
 
 	//check(argc >= 4, "Usage: %s [Port] [Party] [Value]...", argv[0]);
-	check(argc >= 3, "Usage: %s Port Party");
+	check(argc >= 3, "Usage: %s Port Party [full|truncated]", argv[0]);
 
 	// read party
 	int party = 0;
@@ -25,6 +26,14 @@ int main(int argc, char **argv) {
 	}
 	check(party > 0, "Party must be either 1 or 2.");
 
+	// multiplication engine, to compare their gate counts
+	if(argc > 3) {
+		check(!strcmp(argv[3], "full") || !strcmp(argv[3], "truncated"),
+			"Multiplication engine must be full or truncated");
+		check(ofixed_set_mul_engine(strcmp(argv[3], "truncated") ? OFIXED_MUL_FULL : OFIXED_MUL_TRUNCATED),
+			"Multiplication engine %s is not supported by this backend", argv[3]);
+	}
+
 	// generate inputs
 	io.p = precision;
 	//io.len = argc - 3;
@@ -48,6 +57,9 @@ int main(int argc, char **argv) {
 		printf("Time elapsed: %f\n", wallClock() - time);
 		printf("Number of gates: %d\n", io.gates);
 		printf("Result: %f\n", fixed_to_double(io.result, precision));
+		printf("Gates of ofixed_mul and ofixed_add: %zd\n", io.mul_gates);
+		printf("Gates of ofixed_acc_mac: %zd\n", io.acc_gates);
+		printf("Result with ofixed_acc_mac: %f\n", fixed_to_double(io.acc_result, precision));
 	}
 	free(io.inputs);
 	ret = 0;
@@ -2,8 +2,10 @@
 #include "fixed.h"
 
 typedef struct protocolIO {
-	fixed_t *inputs, result;
+	fixed_t *inputs, result, acc_result;
 	size_t len, gates;
+	// of the dot product with ofixed_mul and ofixed_add, and with ofixed_acc_mac
+	size_t mul_gates, acc_gates;
 	int p;
 } protocolIO;
 
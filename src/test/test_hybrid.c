@@ -0,0 +1,139 @@
+#include <obliv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "test/test_hybrid.h"
+#include "linear.h"
+#include "util.h"
+#include "check_error.h"
+
+// Compares p'*A from the hybrid engine with garbled dot products of ofixed_mul
+// and with the exact result. Both parties generate the same operands, so that
+// party 1 can compute the exact result. Party 1 fails if the hybrid result is
+// not exact, or if the garbled one is off by more than one ulp per product.
+
+typedef unsigned __int128 u128;
+
+const size_t d = 8;
+
+static double uniform(double lo, double hi) {
+	return lo + (hi - lo) * rand() / RAND_MAX;
+}
+
+// a and p in [-1, 1)
+static void small_case(hybridCase *test, int p) {
+	for(size_t ij = 0; ij < d * (d+1) / 2; ij++) {
+		test->a[ij] = double_to_fixed(uniform(-1, 1), p);
+	}
+	for(size_t j = 0; j < d; j++) {
+		test->p[j] = double_to_fixed(uniform(-1, 1), p);
+	}
+}
+
+// Entries of A and p close to the largest magnitude m of the fixed-point
+// format. With 64 bits, their products are close to half of the bound
+// 2^(127 - 2p) up to which the hybrid engine is exact. The results stay in
+// range: a(2i+s, 2k+t) = (-1)^(s+t) b(i,k) for a symmetric b, and
+// p[2k+1] = p[2k] + e_k for small e_k, so the products cancel in pairs up to
+// b(i,k) e_k.
+static void large_case(hybridCase *test, int p) {
+	double m = ldexp(1, fixed_width() - 1 - p) - 1;
+	double *b = malloc(d * d / 4 * sizeof(double));
+	for(size_t i = 0; i < d / 2; i++) {
+		for(size_t k = 0; k <= i; k++) {
+			b[i * d / 2 + k] = b[k * d / 2 + i] = (rand() % 2 ? 1 : -1) * uniform(m / 2, m);
+		}
+	}
+	for(size_t i = 0; i < d; i++) {
+		for(size_t j = 0; j <= i; j++) {
+			double sign = (i + j) % 2 ? -1 : 1;
+			test->a[idx(i,j)] = double_to_fixed(sign * b[i / 2 * d / 2 + j / 2], p);
+		}
+	}
+	for(size_t k = 0; k < d / 2; k++) {
+		double q = (rand() % 2 ? 1 : -1) * uniform(m / 2, m - 1);
+		test->p[2*k] = double_to_fixed(q, p);
+		test->p[2*k+1] = double_to_fixed(q + uniform(-1.0 / 64, 1.0 / 64), p);
+	}
+	free(b);
+}
+
+// p'*A mod 2^128, shifted right by p bits and truncated to fixed_t, which is
+// what the hybrid engine computes on its shares
+static fixed_t exact(hybridCase *test, size_t i, int p) {
+	u128 sum = 0;
+	for(size_t j = 0; j < d; j++) {
+		sum += (u128) ((__int128) test->a[idx(i,j)] * test->p[j]);
+	}
+	return (fixed_t) (int64_t) ((__int128) sum >> p);
+}
+
+int main(int argc, char **argv) {
+	ProtocolDesc pd;
+	hybridIO io = {0};
+	int ret = 1;
+
+	check(argc >= 3, "Usage: %s Port Party", argv[0]);
+
+	// read party
+	int party = 0;
+	if(!strcmp(argv[2], "1")) {
+		party = 1;
+	} else if(!strcmp(argv[2], "2")) {
+		party = 2;
+	}
+	check(party > 0, "Party must be either 1 or 2.");
+
+	io.d = d;
+	io.p = fixed_width() - 8;
+	io.cases[0].name = "small";
+	io.cases[1].name = "large";
+	for(int c = 0; c < 2; c++) {
+		io.cases[c].a = malloc(d * (d+1) / 2 * sizeof(fixed_t));
+		io.cases[c].p = malloc(d * sizeof(fixed_t));
+		io.cases[c].dot = malloc(d * sizeof(fixed_t));
+		io.cases[c].hybrid = malloc(d * sizeof(fixed_t));
+		check(io.cases[c].a && io.cases[c].p && io.cases[c].dot && io.cases[c].hybrid, "out of memory");
+	}
+	srand(42);
+	small_case(&io.cases[0], io.p);
+	large_case(&io.cases[1], io.p);
+
+	ocTestUtilTcpOrDie(&pd, party==1, argv[1]);
+	setCurrentParty(&pd, party);
+	execYaoProtocol(&pd, test_hybrid, &io);
+	cleanupProtocol(&pd);
+
+	check(io.ok, "Could not set up the hybrid engine");
+	bool passed = true;
+	if(party == 1) {
+		printf("width %d, precision %d, d = %zd\n", fixed_width(), io.p, d);
+		printf("%-6s %18s %18s\n", "case", "hybrid error (ulp)", "dot error (ulp)");
+		for(int c = 0; c < 2; c++) {
+			hybridCase *test = &io.cases[c];
+			double hybrid_error = 0, dot_error = 0;
+			for(size_t i = 0; i < d; i++) {
+				fixed_t x = exact(test, i, io.p);
+				hybrid_error = fmax(hybrid_error, fabs((double) test->hybrid[i] - (double) x));
+				dot_error = fmax(dot_error, fabs((double) test->dot[i] - (double) x));
+			}
+			printf("%-6s %18.1f %18.1f\n", test->name, hybrid_error, dot_error);
+			// every product truncated by ofixed_mul is off by less than one ulp
+			if(hybrid_error > 0 || dot_error > d) {
+				fprintf(stderr, "%s: hybrid_matvec and the garbled dot product differ\n", test->name);
+				passed = false;
+			}
+		}
+	}
+	ret = !passed;
+
+error:
+	for(int c = 0; c < 2; c++) {
+		free(io.cases[c].a);
+		free(io.cases[c].p);
+		free(io.cases[c].dot);
+		free(io.cases[c].hybrid);
+	}
+	return ret;
+}
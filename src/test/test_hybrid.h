@@ -0,0 +1,20 @@
+#pragma once
+#include <stdbool.h>
+#include "fixed.h"
+
+// one product p'*A for a packed symmetric d x d matrix A and a vector p
+typedef struct {
+	const char *name;
+	fixed_t *a, *p;
+	fixed_t *dot; // garbled, by ofixed_mul and ofixed_add
+	fixed_t *hybrid; // by hybrid_matvec on arithmetic shares
+} hybridCase;
+
+typedef struct hybridIO {
+	hybridCase cases[2];
+	size_t d;
+	int p;
+	bool ok; // whether the hybrid engine could be set up
+} hybridIO;
+
+void test_hybrid(void *v);
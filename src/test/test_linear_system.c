@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <obliv.h>
 #include <stdio.h>
+#include <string.h>
 #include "linear.h"
 #include "util.h"
 #include "check_error.h"
@@ -78,10 +79,12 @@ error:	// for some reason, oblivc removes this label if the stuff
 
 
 int main(int argc, char **argv) {
-	check(argc != 6, "Usage: %s [Port] [Party] [Input file] [Algorithm] [Num. iterations CGD] [Precision]", argv[0]);
+	subset_t *subsets = NULL;
+	size_t num_subsets = 0;
+	check(argc == 7 || argc == 8, "Usage: %s [Port] [Party] [Input file] [Algorithm] [Num. iterations CGD] [Precision] [Subsets]", argv[0]);
 	char *algorithm = argv[4];
-	check(!strcmp(algorithm, "cholesky") || !strcmp(algorithm, "ldlt")  || !strcmp(algorithm, "cgd"),
-	      "Algorithm must be cholesky, ldlt, or cgd.");
+	const linear_solver_t *solver = linear_solver_find(algorithm);
+	check(solver, "Algorithm must be cholesky, cholesky_rsqrt, cholesky_recip, ldlt, ldlt_recip, ldlt_mixed, cgd, cgd_pow2, or cgd_jacobi.");
 	//check(strcmp(algorithm, "cgd") || argc == 6, "Number of iterations for CGD must be provided");
 	char *end;
 	precision = (int) strtol(argv[6], &end, 10);
@@ -95,9 +98,16 @@ int main(int argc, char **argv) {
 	}
 	check(party > 0, "Party must be either 1 or 2.");
 
-	linear_system_t ls;
+	linear_system_t ls = {0};
 	read_ls_from_file(party, argv[3], &ls);
-	if(!strcmp(algorithm, "cgd")){
+	// solves for every subset of columns instead, as with --subsets of bin/main
+	if(argc == 8) {
+		check(!subsets_parse(argv[7], &subsets, &num_subsets), "Could not parse the subsets");
+		for(size_t k = 0; k < num_subsets; k++) {
+			check(subsets[k].cols[subsets[k].len - 1] < ls.a.d[0], "Subset %zd has columns beyond d = %zd", k, ls.a.d[0]);
+		}
+	}
+	if(solver->iterative){
 	       ls.num_iterations = atoi(argv[5]);
 	} else {
 	       ls.num_iterations = 0;
@@ -112,18 +122,13 @@ int main(int argc, char **argv) {
 	      printf("\n");
 	      printf("Algorithm: %s\n", algorithm);
 	}
-	void (*algorithms[])(void *) = {cholesky, ldlt, cgd};
-	int alg_index;
-	if(!strcmp(algorithm, "cholesky")) {
-              alg_index = 0;
-	} else if (!strcmp(algorithm, "ldlt")) {
-              alg_index = 1;
+	if(num_subsets) {
+		subset_args args = {&ls, solver->solve, subsets, num_subsets};
+		execYaoProtocol(&pd, solve_subsets, &args);
 	} else {
-	      alg_index = 2;
+		execYaoProtocol(&pd, solver->solve, &ls);
 	}
-
-	execYaoProtocol(&pd, algorithms[alg_index], &ls);
-	//execDebugProtocol(&pd, algorithms[alg_index], &ls);
+	//execDebugProtocol(&pd, solver->solve, &ls);
 
 	if(party == 2) {
 	  //check(ls.beta.len == d, "Computation error.");
@@ -163,8 +168,10 @@ int main(int argc, char **argv) {
 	free(ls.a.value);
 	free(ls.b.value);
 	if (ls.beta.value) free(ls.beta.value);
+	subsets_free(subsets, num_subsets);
 
 	return 0;
 error:
+	subsets_free(subsets, num_subsets);
 	return 1;
 }